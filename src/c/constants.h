@@ -11,25 +11,39 @@
 // Max number of samples
 #define MAX_NSAMPLES 4000
 
+// Number of kissfft plans kept by get_fft_plan(). When a segment size is
+// not in the cache the least recently used plan is replaced.
+#define FFT_PLAN_CACHE_SIZE 4
+
 // Used in array initialisations.
 #define MAX_NSEGMENTS 70
 
-// Max size for the tokenizer used to create data_array.
-#define MAX_TOKEN_SIZE 10
-
-// maximum size for the data array.
-#define MAX_DATA_ARRAY_SIZE 150000
-
 // Epsilon used in comparison of signals.
 #define EPSILON 0.1
 
 // Set to use the heap on some places.
 #define USE_MALLOC 1
 
+// Set to cancel segments of an even size with the real fft (kiss_fftr).
+// FREQ_CANCELLATION_PERCENTAGE then applies to the nfft/2+1 bins of the
+// half-spectrum instead of the nfft bins of the complex spectrum.
+#define USE_REAL_FFT 0
+
+// Set to also run the original scan of recognizeEnd(), which sums every
+// window again, and stop if it finds a different end of noise than the
+// prefix sums. Used to check that both detect the same noise indices,
+// see the check target of the Makefile.
+#ifndef CHECK_RECOGNIZE_END
+#define CHECK_RECOGNIZE_END 0
+#endif
+
 // Number of samples, only used for testing.
 #define NSAMPLES 16
 
-// File to read data_array from.
+// File to read data_array from. When a file with the same name and the
+// extension .raw exists, data_array is read from it instead. It contains
+// the same values as int16 little endian, e.g. made with the convert tool
+// of the realtime version: ./convert data_array.txt data_array.raw
 #define FILE_DATA_ARRAY "../../resources/data_array.txt"
 
 // File to save new_data_array.txt to.
@@ -51,8 +65,8 @@ enum error_code {
     NOT_OK = 0x0001,
 };
 
-// Data to simulate microphone input.
-int16_t data_array[MAX_DATA_ARRAY_SIZE];
+// Data to simulate microphone input, allocated by read_data_from_file().
+int16_t *data_array;
 
 // Size of the simulate microphone input to be filled in main.c.
 size_t data_array_size;
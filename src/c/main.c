@@ -4,7 +4,13 @@
 #include <stdint.h>
 // https://github.com/mborgerding/kissfft
 #include "kissfft/kiss_fft.h"
+#include "kissfft/tools/kiss_fftr.h"
 #include <inttypes.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "constants.h"
 
 /*** Prototypes ***/
@@ -55,6 +61,17 @@ void create_signal(kiss_fft_cpx* cx_in, const int n);
 
 int recognizeEnd(int start, unsigned long startMedium);
 
+// Fill abs_prefix_sums for the current data_array.
+int fill_abs_prefix_sums(void);
+
+// Return the sum of abs(data_array[i]) for beg <= i < end in O(1).
+unsigned long abs_sum_between(const int beg, const int end);
+
+// Returns end. If CHECK_RECOGNIZE_END is set it exits if the original scan
+// of recognizeEnd() would have found another end for the noise at start.
+int check_recognize_end(const int end, const int start,
+        const unsigned long startMedium);
+
 // Get the signal and put it in the argument kissfft complex array.
 // cx_in must have enough space to hold a segment.
 // the segment is retrieved from data_array.
@@ -96,6 +113,77 @@ void make_zero2d(kiss_fft_cpx** cx_in, const int rows, const int cols);
 
 int free_global_resources();
 
+// Bluestein's (chirp-z) algorithm computes a fourier transform of any size
+// nfft as a convolution of size mfft >= 2*nfft-1 which only has the factors
+// 2, 3 and 5. kissfft is O(nfft*p) for every prime factor p, so this keeps
+// segment sizes with large prime factors O(n log n).
+struct bluestein {
+    int nfft;
+    int mfft;
+    kiss_fft_cfg fourier_state;             // mfft samples.
+    kiss_fft_cfg inverse_fourier_state;     // mfft samples.
+    kiss_fft_cpx *chirp;                    // nfft samples, exp(-i*pi*n^2/nfft).
+    kiss_fft_cpx *chirp_fourier;            // mfft samples, divided by mfft.
+    kiss_fft_cpx *work;                     // mfft samples.
+    kiss_fft_cpx *work_fourier;             // mfft samples.
+};
+
+// Return TRUE if a fourier transform of nfft samples is estimated to be
+// faster with Bluestein's algorithm than with kissfft.
+int needs_bluestein(const int nfft);
+
+// Allocate and compute the chirp of nfft samples. Returns NULL on failure.
+struct bluestein* create_bluestein(const int nfft);
+
+// Same (not normalized) transform as kiss_fft on nfft samples.
+void bluestein_fft(struct bluestein *b, const kiss_fft_cpx *in,
+        kiss_fft_cpx *out, const int inverse);
+
+void free_bluestein(struct bluestein *b);
+
+// kissfft states and work buffers for one segment size.
+struct fft_plan {
+    int nfft;                   // Segment size, 0 if unused.
+    int real;                   // TRUE if the kiss_fftr states are used.
+    unsigned long last_used;    // Value of fft_plan_clock at last use.
+    kiss_fft_cfg fourier_state;
+    kiss_fft_cfg inverse_fourier_state;
+    struct bluestein *bluestein;    // Replaces the states above if not NULL.
+    kiss_fftr_cfg real_fourier_state;
+    kiss_fftr_cfg real_inverse_fourier_state;
+    kiss_fft_cpx *noise_segment;            // nfft samples.
+    kiss_fft_scalar *real_noise_segment;    // nfft samples.
+    kiss_fft_cpx *noise_segment_fourier;    // nfft or nfft/2+1 samples.
+};
+
+// Get the cached plan for segments of nfft samples, creates it if needed.
+// Returns NULL if the plan could not be allocated.
+struct fft_plan* get_fft_plan(const int nfft);
+
+// Free all cached plans.
+void free_fft_plans(void);
+
+// Free the states and buffers of one plan.
+void free_fft_plan(struct fft_plan *plan);
+
+// Fourier transform of a complex plan.
+void plan_fft(struct fft_plan *plan, const kiss_fft_cpx *in,
+        kiss_fft_cpx *out);
+
+// The fourier transform of a real signal has out[n-k] == conj(out[k]). The
+// rounding errors of Bluestein's algorithm break this symmetry, which would
+// make highest_frequency_real() pick the mirrored frequency of an equal pair.
+void make_conjugate_symmetric(kiss_fft_cpx *s, const int n);
+
+// Like ifft_and_restore, but with the inverse transform of a complex plan.
+int plan_ifft_and_restore(struct fft_plan *plan, const kiss_fft_cpx *in,
+        kiss_fft_cpx *out);
+
+// Create cancelling noise for a segment with a real plan, using only the
+// nfft/2+1 bins of the half-spectrum.
+int real_fft_cancel(struct fft_plan *plan, const int start_noise,
+        const int end_noise, kiss_fft_cpx *cx_out);
+
 // Copy data_array and replace noise segments with the cancelling noise
 // segments data in the copy. This is for testing purposes as this is clearly
 // not realtime.
@@ -111,16 +199,19 @@ int cx_print_values_between(const kiss_fft_cpx *s, const int beg, const int end)
 
 int write_signal_to_file(const char* filename, const int16_t* s, const int n);
 
-/* Tokenize a string. Save tokens in 'tokens' */
-/* Returns the number of tokens created. */
-int tokenize(char* str, char** tokens, char* delim);
+/* Used to fill data_array. Also sets data_array_size. Reads the .raw file
+ * next to filename when it exists. */
+int read_data_from_file(const char* filename);
 
-/* Used to fill data_array. Also sets data_array_size. */
-int read_data_from_file(int16_t* data_array, const int n, char* filename);
+// Parse the comma separated integers of text into data_array.
+int parse_data_array(const char* text, const size_t size);
 
+// Read data_array from a file of int16 little endian values.
+int read_raw_data_array(const int fd, const size_t size);
 
+// Return the up to 8 bytes of text at i, zero padded at the end of text.
+uint64_t load_8_bytes(const char* text, const size_t i, const size_t size);
 
-void print_tokens(char** tokens, int n);
 void print_ints(int16_t* a, int n);
 
 /* Return index of highest absolute real frequency. */
@@ -145,6 +236,15 @@ int end_noise[MAX_NSEGMENTS];
 // Actual number of noise segments.
 int num_noise_segments = 0;
 
+// abs_prefix_sums[i] is the sum of abs(data_array[j]) for all j < i, so the
+// sum of any window is one subtraction.
+unsigned long long *abs_prefix_sums = NULL;
+
+// Cache of kissfft plans, so segments of the same size do not allocate and
+// compute the twiddle factors again.
+struct fft_plan fft_plans[FFT_PLAN_CACHE_SIZE];
+unsigned long fft_plan_clock = 0;
+
 // Segments of anti-noise that will be output to the speaker.
 #if USE_MALLOC
 kiss_fft_cpx** cx_cancelling_segments;
@@ -154,25 +254,34 @@ kiss_fft_cpx cx_cancelling_segments[MAX_NSEGMENTS][MAX_NSAMPLES];
 
 // The program
 int main(void) {
-    read_data_from_file(data_array, MAX_DATA_ARRAY_SIZE, FILE_DATA_ARRAY);
+    if (read_data_from_file(FILE_DATA_ARRAY) != OK) return EXIT_FAILURE;
 
     for (int i = 0; ; ++i) {
         int r;
         r = do_recognize();
         /* print_noise_indices(); */
+#if CHECK_RECOGNIZE_END
+        print_noise_indices();
+#endif
         if (r != OK) return EXIT_FAILURE;
         r = do_cancel();
         if (r != OK) return EXIT_FAILURE;
         /* r = do_output_to_speaker(); */
         /* if (r != OK) return EXIT_FAILURE; */
 
-        int16_t new_data_array[data_array_size];
+        // Too large for the stack on long recordings.
+        int16_t *new_data_array = malloc(sizeof(int16_t) * data_array_size);
+        if (new_data_array == NULL) {
+            fprintf(stderr, "main: error, malloc failed for new_data_array\n");
+            return EXIT_FAILURE;
+        }
         copy_signal_and_write_segments_to_copied_signal(new_data_array);
 
         
         /* print_signal(new_data_array, data_array_size); */
         write_signal_to_file(FILE_NEW_DATA_ARRAY, new_data_array,
                 data_array_size);
+        free(new_data_array);
 
 #if USE_MALLOC
         free_global_resources();
@@ -209,10 +318,6 @@ int do_cancel() {
     make_zero2d(cx_cancelling_segments, num_noise_segments, MAX_NSAMPLES);
 #endif
 
-    // kissfft state buffers.
-    kiss_fft_cfg kfft_fourier_state;
-    kiss_fft_cfg kfft_inverse_fourier_state;
-
     // For all noise segments:
     //
     // 1. Get a noise segment.
@@ -223,18 +328,31 @@ int do_cancel() {
         // Compute the length of the segment.
         segment_sizes[i] = end_noise[i] - start_noise[i];
 
-        // Initialise the kissfft state buffers.
-        kfft_fourier_state = kiss_fft_alloc(segment_sizes[i], FOURIER, 0, 0);
-        kfft_inverse_fourier_state = kiss_fft_alloc(segment_sizes[i],
-                INVERSE_FOURIER, 0, 0);
-
         if (segment_sizes[i] > MAX_NSAMPLES) {
             fprintf(stderr, "do_cancel: I cannot fit it in it is too big!\n");
             goto fail;
         }
 
+        // Get the kissfft state buffers and work buffers for this size.
+        struct fft_plan *plan = get_fft_plan(segment_sizes[i]);
+        if (plan == NULL) {
+            fprintf(stderr, "do_cancel: error while getting fft plan.\n");
+            goto fail;
+        }
+
+        if (plan->real) {
+            // 1-4. with the real fft.
+            r = real_fft_cancel(plan, start_noise[i], end_noise[i],
+                    cx_cancelling_segments[i]);
+            if (r != OK) {
+                fprintf(stderr, "do_cancel: error in the real fft.\n");
+                goto fail;
+            }
+            continue;
+        }
+
         // 1. Get a noise segment.
-        kiss_fft_cpx cx_noise_segment[segment_sizes[i]];
+        kiss_fft_cpx *cx_noise_segment = plan->noise_segment;
         cx_make_zero(cx_noise_segment, segment_sizes[i]);
         r = get_noise_segment(cx_noise_segment, start_noise[i], end_noise[i]);
         if (r != OK) {
@@ -243,9 +361,13 @@ int do_cancel() {
         }
 
         // 2. Compute Fourier to get the noise frequencies.
-        kiss_fft_cpx cx_noise_segment_fourier[segment_sizes[i]];
+        kiss_fft_cpx *cx_noise_segment_fourier = plan->noise_segment_fourier;
         cx_make_zero(cx_noise_segment_fourier, segment_sizes[i]);
-        kiss_fft(kfft_fourier_state, cx_noise_segment, cx_noise_segment_fourier);
+        plan_fft(plan, cx_noise_segment, cx_noise_segment_fourier);
+        if (plan->bluestein != NULL) {
+            make_conjugate_symmetric(cx_noise_segment_fourier,
+                    segment_sizes[i]);
+        }
 
         /* // 3. Invert all frequencies. */
         /* r = invert_all_frequencies(cx_noise_segment_fourier, segment_sizes[i]); */
@@ -282,29 +404,18 @@ int do_cancel() {
                     i);
             goto fail;
         }
-        r = ifft_and_restore(&kfft_inverse_fourier_state,
-                cx_noise_segment_fourier, cx_cancelling_segments[i],
-                segment_sizes[i]);
+        r = plan_ifft_and_restore(plan, cx_noise_segment_fourier,
+                cx_cancelling_segments[i]);
         if (r != OK) {
             fprintf(stderr, "do_cancel: error while executing inverse fft.\n");
             goto fail;
         }
-
-        // Free configs.
-        free(kfft_fourier_state);
-        free(kfft_inverse_fourier_state);
-        kfft_fourier_state = NULL;
-        kfft_inverse_fourier_state = NULL;
     }
 
     printf("\n##### DONE with do_cancel! #####\n");
     return OK;
 
 fail:
-    free(kfft_fourier_state);
-    free(kfft_inverse_fourier_state);
-    kfft_fourier_state = NULL;
-    kfft_inverse_fourier_state = NULL;
 #if USE_MALLOC
     free_global_resources();
 #endif
@@ -509,34 +620,83 @@ int recognizeEnd(int start, unsigned long startMedium) {
         maxLoop = data_array_size - LOOP_SIZE;
     }
     /* printf("start noise %d", start); */
-    // Loop from start of noise to max 0.5 second further.
-    for(int k = start; k < maxLoop; k++) {
-        counter = 0;
-        //printf("rec %d avg: %d point: %d\n", startMedium, average, ((k - start)%LOOP_SIZE));
+    // Loop from start of noise to max 0.5 second further, the average is
+    // only checked every LOOP_SIZE samples. The window of the last k has
+    // to end within data_array.
+    for(int k = start; k < maxLoop && k + LOOP_SIZE <= data_array_size;
+            k += LOOP_SIZE) {
+        if (k == 0) {
+            continue;
+        }
 
         // Check if noise drasticly decreases in next 0.05 seconds 
-        for(int i = k; i < (k + LOOP_SIZE); i++) {
-            counter += abs(data_array[i]);
-        }
-        if((k - start)%LOOP_SIZE == 0 && k != 0) {
-            
-            average = counter / LOOP_SIZE;
-            counter = 0;
-            int safeZone = average / 2;
-            // If average is lower than the value at the start of the noise, noise
-            // ended so function is stopped.
-             printf("inend %d, temp: %d, avg: %d, safe: %d \n", k, startMedium, average, safeZone);
-            if(average <= (startMedium + safeZone)) {
-                printf(" end noise %d \n", k);
-                return k;
-            }
+        counter = abs_sum_between(k, k + LOOP_SIZE);
+        average = counter / LOOP_SIZE;
+        int safeZone = average / 2;
+        // If average is lower than the value at the start of the noise, noise
+        // ended so function is stopped.
+         printf("inend %d, temp: %d, avg: %d, safe: %d \n", k, startMedium, average, safeZone);
+        if(average <= (startMedium + safeZone)) {
+            printf(" end noise %d \n", k);
+            return check_recognize_end(k, start, startMedium);
         }
-
     }
     //printf("MAXEND \n");
     //No end of noise is detected, detected noise get discarded.
     /* printf("end noise \n"); */
-    return maxLoop;
+    return check_recognize_end(maxLoop, start, startMedium);
+}
+
+int fill_abs_prefix_sums(void) {
+    free(abs_prefix_sums);
+    abs_prefix_sums = malloc(sizeof(unsigned long long) * (data_array_size + 1));
+    if (abs_prefix_sums == NULL) {
+        fprintf(stderr, "fill_abs_prefix_sums: error in allocating.\n");
+        return NOT_OK;
+    }
+    abs_prefix_sums[0] = 0;
+    for (int i = 0; i < data_array_size; ++i) {
+        abs_prefix_sums[i + 1] = abs_prefix_sums[i] + abs(data_array[i]);
+    }
+    return OK;
+}
+
+unsigned long abs_sum_between(const int beg, const int end) {
+    return abs_prefix_sums[end] - abs_prefix_sums[beg];
+}
+
+int check_recognize_end(const int end, const int start,
+        const unsigned long startMedium) {
+#if CHECK_RECOGNIZE_END
+    // The original scan: sum the window again for every k.
+    int expected = -1;
+    unsigned long maxCount = start + MAX_NSAMPLES;
+    unsigned long maxLoop = maxCount < data_array_size ? maxCount :
+        data_array_size - LOOP_SIZE;
+    for (int k = start; k < maxLoop && k + LOOP_SIZE <= data_array_size &&
+            expected < 0; k++) {
+        unsigned long counter = 0;
+        for (int i = k; i < (k + LOOP_SIZE); i++) {
+            counter += abs(data_array[i]);
+        }
+        if ((k - start) % LOOP_SIZE == 0 && k != 0) {
+            unsigned long average = counter / LOOP_SIZE;
+            if (average <= (startMedium + average / 2)) {
+                expected = k;
+            }
+        }
+    }
+    if (expected < 0) {
+        expected = maxLoop;
+    }
+    if (expected != end) {
+        fprintf(stderr, "check_recognize_end: noise starting at %d ends at"
+                " %d, but the original scan ends it at %d.\n", start, end,
+                expected);
+        exit(EXIT_FAILURE);
+    }
+#endif
+    return end;
 }
 
 int do_recognize(void) {
@@ -555,6 +715,10 @@ int do_recognize(void) {
     num_noise_segments = 0;
 
     
+    if (fill_abs_prefix_sums() != OK) {
+        return NOT_OK;
+    }
+
     printf("%d \n", data_array[0]);
     LOOP_SIZE = data_array[0];
     INITIAL_LOOP_SIZE = data_array[0];
@@ -737,6 +901,281 @@ void make_zero2d(kiss_fft_cpx** cx_in, const int rows, const int cols) {
 int free_global_resources() {
     free(cx_cancelling_segments);
     cx_cancelling_segments = NULL;
+    free(abs_prefix_sums);
+    abs_prefix_sums = NULL;
+    free(data_array);
+    data_array = NULL;
+    free_fft_plans();
+    return OK;
+}
+
+struct fft_plan* get_fft_plan(const int nfft) {
+    struct fft_plan *least_recent = &fft_plans[0];
+
+    ++fft_plan_clock;
+    for (int i = 0; i < FFT_PLAN_CACHE_SIZE; ++i) {
+        if (fft_plans[i].nfft == nfft) {
+            fft_plans[i].last_used = fft_plan_clock;
+            return &fft_plans[i];
+        }
+        if (fft_plans[i].last_used < least_recent->last_used) {
+            least_recent = &fft_plans[i];
+        }
+    }
+
+    // Not cached, replace the least recently used plan.
+    free_fft_plan(least_recent);
+
+    least_recent->nfft = nfft;
+    // kiss_fftr uses a complex transform of nfft/2 samples internally,
+    // which can not be replaced by Bluestein's algorithm.
+    least_recent->real = USE_REAL_FFT && nfft % 2 == 0 &&
+        !needs_bluestein(nfft / 2);
+    least_recent->last_used = fft_plan_clock;
+    if (least_recent->real) {
+        least_recent->real_fourier_state = kiss_fftr_alloc(nfft, FOURIER,
+                0, 0);
+        least_recent->real_inverse_fourier_state = kiss_fftr_alloc(nfft,
+                INVERSE_FOURIER, 0, 0);
+        least_recent->real_noise_segment =
+            malloc(sizeof(kiss_fft_scalar) * nfft);
+        least_recent->noise_segment_fourier =
+            malloc(sizeof(kiss_fft_cpx) * (nfft / 2 + 1));
+    } else if (needs_bluestein(nfft)) {
+        least_recent->bluestein = create_bluestein(nfft);
+        least_recent->noise_segment = malloc(sizeof(kiss_fft_cpx) * nfft);
+        least_recent->noise_segment_fourier =
+            malloc(sizeof(kiss_fft_cpx) * nfft);
+    } else {
+        least_recent->fourier_state = kiss_fft_alloc(nfft, FOURIER, 0, 0);
+        least_recent->inverse_fourier_state = kiss_fft_alloc(nfft,
+                INVERSE_FOURIER, 0, 0);
+        least_recent->noise_segment = malloc(sizeof(kiss_fft_cpx) * nfft);
+        least_recent->noise_segment_fourier =
+            malloc(sizeof(kiss_fft_cpx) * nfft);
+    }
+
+    if ((least_recent->real ?
+                (least_recent->real_fourier_state == NULL ||
+                 least_recent->real_inverse_fourier_state == NULL ||
+                 least_recent->real_noise_segment == NULL) :
+                ((least_recent->bluestein == NULL &&
+                  (least_recent->fourier_state == NULL ||
+                   least_recent->inverse_fourier_state == NULL)) ||
+                 least_recent->noise_segment == NULL)) ||
+            least_recent->noise_segment_fourier == NULL) {
+        fprintf(stderr, "get_fft_plan: error in allocating plan.\n");
+        // Leave the plan unused so it is not returned next time.
+        free_fft_plan(least_recent);
+        return NULL;
+    }
+    return least_recent;
+}
+
+void free_fft_plans(void) {
+    for (int i = 0; i < FFT_PLAN_CACHE_SIZE; ++i) {
+        free_fft_plan(&fft_plans[i]);
+    }
+    fft_plan_clock = 0;
+}
+
+void free_fft_plan(struct fft_plan *plan) {
+    free(plan->fourier_state);
+    free(plan->inverse_fourier_state);
+    free_bluestein(plan->bluestein);
+    kiss_fftr_free(plan->real_fourier_state);
+    kiss_fftr_free(plan->real_inverse_fourier_state);
+    free(plan->noise_segment);
+    free(plan->real_noise_segment);
+    free(plan->noise_segment_fourier);
+    *plan = (struct fft_plan) { 0 };
+}
+
+void plan_fft(struct fft_plan *plan, const kiss_fft_cpx *in,
+        kiss_fft_cpx *out) {
+    if (plan->bluestein != NULL) {
+        bluestein_fft(plan->bluestein, in, out, FALSE);
+    } else {
+        kiss_fft(plan->fourier_state, in, out);
+    }
+}
+
+void make_conjugate_symmetric(kiss_fft_cpx *s, const int n) {
+    s[0].i = 0.0;
+    for (int k = 1; k <= n / 2; ++k) {
+        const kiss_fft_scalar r = (s[k].r + s[n - k].r) / 2;
+        const kiss_fft_scalar i = (s[k].i - s[n - k].i) / 2;
+        s[k].r = s[n - k].r = r;
+        s[k].i = i;
+        s[n - k].i = -i;
+    }
+}
+
+int plan_ifft_and_restore(struct fft_plan *plan, const kiss_fft_cpx *in,
+        kiss_fft_cpx *out) {
+    if (plan->bluestein == NULL) {
+        return ifft_and_restore(&plan->inverse_fourier_state, in, out,
+                plan->nfft);
+    }
+    bluestein_fft(plan->bluestein, in, out, TRUE);
+    for (int i = 0; i < plan->nfft; ++i) {
+        out[i].r /= plan->nfft;
+        out[i].i /= plan->nfft;
+    }
+    return OK;
+}
+
+// Rough number of complex multiplications of kissfft for nfft samples:
+// every stage costs nfft times its radix, except for the specialised
+// butterflies of radix 2 to 5 which are counted as 1.
+double kiss_fft_cost(const int nfft) {
+    double cost = 0.0;
+    int remaining = nfft;
+    for (int p = 2; p * p <= remaining; ++p) {
+        while (remaining % p == 0) {
+            cost += (double) nfft * (p <= 5 ? 1 : p);
+            remaining /= p;
+        }
+    }
+    if (remaining > 1) {
+        cost += (double) nfft * (remaining <= 5 ? 1 : remaining);
+    }
+    return cost;
+}
+
+int needs_bluestein(const int nfft) {
+    if (nfft < 2) {
+        return FALSE;
+    }
+    // Three transforms of mfft samples and three element-wise products.
+    const int mfft = kiss_fft_next_fast_size(2 * nfft - 1);
+    return 3 * kiss_fft_cost(mfft) + 3.0 * mfft < kiss_fft_cost(nfft);
+}
+
+struct bluestein* create_bluestein(const int nfft) {
+    struct bluestein *b = calloc(1, sizeof(struct bluestein));
+    if (b == NULL) {
+        return NULL;
+    }
+    const int mfft = kiss_fft_next_fast_size(2 * nfft - 1);
+    b->nfft = nfft;
+    b->mfft = mfft;
+    b->fourier_state = kiss_fft_alloc(mfft, FOURIER, 0, 0);
+    b->inverse_fourier_state = kiss_fft_alloc(mfft, INVERSE_FOURIER, 0, 0);
+    b->chirp = malloc(sizeof(kiss_fft_cpx) * nfft);
+    b->chirp_fourier = malloc(sizeof(kiss_fft_cpx) * mfft);
+    b->work = malloc(sizeof(kiss_fft_cpx) * mfft);
+    b->work_fourier = malloc(sizeof(kiss_fft_cpx) * mfft);
+    if (b->fourier_state == NULL || b->inverse_fourier_state == NULL ||
+            b->chirp == NULL || b->chirp_fourier == NULL || b->work == NULL ||
+            b->work_fourier == NULL) {
+        free_bluestein(b);
+        return NULL;
+    }
+
+    // n^2 modulo 2*nfft gives the same angle, but keeps it precise.
+    for (int n = 0; n < nfft; ++n) {
+        long long square = (long long) n * n % (2LL * nfft);
+        double angle = -M_PI * (double) square / nfft;
+        b->chirp[n].r = cos(angle);
+        b->chirp[n].i = sin(angle);
+    }
+
+    // The filter is conj(chirp[|m|]) for -nfft < m < nfft, the negative
+    // indices wrap around to the end.
+    cx_make_zero(b->work, mfft);
+    for (int n = 0; n < nfft; ++n) {
+        b->work[n].r = b->chirp[n].r;
+        b->work[n].i = -b->chirp[n].i;
+        if (n > 0) {
+            b->work[mfft - n] = b->work[n];
+        }
+    }
+    kiss_fft(b->fourier_state, b->work, b->chirp_fourier);
+    for (int m = 0; m < mfft; ++m) {
+        b->chirp_fourier[m].r /= mfft;
+        b->chirp_fourier[m].i /= mfft;
+    }
+    return b;
+}
+
+// The inverse uses ifft(x) = conj(fft(conj(x))).
+void bluestein_fft(struct bluestein *b, const kiss_fft_cpx *in,
+        kiss_fft_cpx *out, const int inverse) {
+    const kiss_fft_scalar sign = inverse ? -1 : 1;
+
+    // work = in * chirp, zero padded to mfft samples.
+    for (int n = 0; n < b->nfft; ++n) {
+        kiss_fft_scalar r = in[n].r;
+        kiss_fft_scalar i = sign * in[n].i;
+        b->work[n].r = r * b->chirp[n].r - i * b->chirp[n].i;
+        b->work[n].i = r * b->chirp[n].i + i * b->chirp[n].r;
+    }
+    cx_make_zero(&b->work[b->nfft], b->mfft - b->nfft);
+
+    // Convolve with the conjugated chirp in the fourier domain.
+    kiss_fft(b->fourier_state, b->work, b->work_fourier);
+    for (int m = 0; m < b->mfft; ++m) {
+        kiss_fft_cpx x = b->work_fourier[m];
+        kiss_fft_cpx h = b->chirp_fourier[m];
+        b->work_fourier[m].r = x.r * h.r - x.i * h.i;
+        b->work_fourier[m].i = x.r * h.i + x.i * h.r;
+    }
+    kiss_fft(b->inverse_fourier_state, b->work_fourier, b->work);
+
+    // out = work * chirp.
+    for (int k = 0; k < b->nfft; ++k) {
+        const kiss_fft_cpx w = b->work[k];
+        out[k].r = w.r * b->chirp[k].r - w.i * b->chirp[k].i;
+        out[k].i = sign * (w.r * b->chirp[k].i + w.i * b->chirp[k].r);
+    }
+}
+
+void free_bluestein(struct bluestein *b) {
+    if (b == NULL) {
+        return;
+    }
+    free(b->fourier_state);
+    free(b->inverse_fourier_state);
+    free(b->chirp);
+    free(b->chirp_fourier);
+    free(b->work);
+    free(b->work_fourier);
+    free(b);
+}
+
+int real_fft_cancel(struct fft_plan *plan, const int start_noise,
+        const int end_noise, kiss_fft_cpx *cx_out) {
+    const int n = plan->nfft;
+    const int bins = n / 2 + 1;
+    if (end_noise - start_noise != n) {
+        fprintf(stderr, "real_fft_cancel: segment does not match plan.\n");
+        return NOT_OK;
+    }
+
+    // 1. Get a noise segment, only the real part is needed.
+    for (int i = 0, j = start_noise; j < end_noise; ++i, ++j) {
+        plan->real_noise_segment[i] = data_array[j];
+    }
+
+    // 2. Compute Fourier, only the half-spectrum is computed as the other
+    // half are the complex conjugates for a real signal.
+    kiss_fftr(plan->real_fourier_state, plan->real_noise_segment,
+            plan->noise_segment_fourier);
+
+    // 3. Cancel around the highest frequencies of the half-spectrum.
+    if (cancel_interval(plan->noise_segment_fourier, bins,
+                FREQ_CANCELLATION_PERCENTAGE) != OK) {
+        return NOT_OK;
+    }
+
+    // 4. Compute inverse fourier and restore the signal by dividing by n.
+    kiss_fftri(plan->real_inverse_fourier_state, plan->noise_segment_fourier,
+            plan->real_noise_segment);
+    for (int i = 0; i < n; ++i) {
+        cx_out[i].r = plan->real_noise_segment[i] / n;
+        cx_out[i].i = 0.0;
+    }
     return OK;
 }
 
@@ -790,49 +1229,142 @@ int write_signal_to_file(const char* filename, const int16_t* s, const int n) {
     return OK;
 }
 
-int read_data_from_file(int16_t* data_array, const int n, char* filename) {
-    /* Read from text file. */
-    FILE *f = fopen(filename, "r");
-
-    fseek(f, 0, SEEK_END);
-    long fsize = ftell(f);
-    fseek(f, 0, SEEK_SET);  /* same as rewind(f); */
+int read_data_from_file(const char* filename) {
+    // Same name with the extension .raw.
+    const char *extension = strrchr(filename, '.');
+    size_t length = extension ? (size_t)(extension - filename) :
+        strlen(filename);
+    char *raw_filename = malloc(length + sizeof(".raw"));
+    if (raw_filename == NULL) return NOT_OK;
+    memcpy(raw_filename, filename, length);
+    strcpy(raw_filename + length, ".raw");
+
+    int fd = open(raw_filename, O_RDONLY);
+    free(raw_filename);
+    int is_raw = fd != -1;
+    if (!is_raw) fd = open(filename, O_RDONLY);
+
+    struct stat status;
+    if (fd == -1 || fstat(fd, &status) == -1) {
+        fprintf(stderr, "read_data_from_file: error, cannot open %s\n",
+                filename);
+        return NOT_OK;
+    }
+    size_t size = (size_t) status.st_size;
 
-    char *data = malloc(fsize + 1);
-    fread(data, 1, fsize, f);
-    fclose(f);
+    int r;
+    if (is_raw) {
+        r = read_raw_data_array(fd, size);
+    } else if (size == 0) {
+        r = parse_data_array("", 0);
+    } else {
+        char *text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (text == MAP_FAILED) {
+            fprintf(stderr, "read_data_from_file: error, cannot map %s\n",
+                    filename);
+            close(fd);
+            return NOT_OK;
+        }
+        madvise(text, size, MADV_SEQUENTIAL);
+        r = parse_data_array(text, size);
+        munmap(text, size);
+    }
+    close(fd);
 
-    data[fsize] = 0;
+    /* print_ints(data_array, data_array_size); */
+    return r;
+}
 
-    /* Tokenize */
-    char* tokens[MAX_DATA_ARRAY_SIZE];
-    int num_tokens = tokenize(data, tokens, ",");
-    if (num_tokens > MAX_DATA_ARRAY_SIZE) {
-        fprintf(stderr, "read_data_from_file: error, too many tokens");
+int read_raw_data_array(const int fd, const size_t size) {
+    data_array_size = size / 2;
+    data_array = malloc(sizeof(int16_t) * (data_array_size + 1));
+    if (data_array == NULL) {
+        fprintf(stderr, "read_raw_data_array: error, malloc failed\n");
         return NOT_OK;
     }
 
-    /* Convert tokens to int16. */
-    for (int i = 0; i < num_tokens; ++i) {
-        data_array[i] = (int16_t) strtol(tokens[i], NULL, 10);
+    uint8_t *bytes = (uint8_t *) data_array;
+    size_t done = 0;
+    while (done < data_array_size * 2) {
+        ssize_t n = read(fd, bytes + done, data_array_size * 2 - done);
+        if (n <= 0) {
+            fprintf(stderr, "read_raw_data_array: error, read failed\n");
+            return NOT_OK;
+        }
+        done += (size_t) n;
     }
-
-    /* Set the size of the data array. */
-    data_array_size = num_tokens;
-
-    /* print_tokens(tokens, num_tokens); */
-    /* print_ints(data_array, num_tokens); */
-    return 0;
+    // The file is little endian, this only changes the values on big
+    // endian hosts.
+    for (size_t i = 0; i < data_array_size; ++i) {
+        data_array[i] = (int16_t) (bytes[2 * i] | bytes[2 * i + 1] << 8);
+    }
+    return OK;
 }
 
-int tokenize(char* str, char** tokens, char* delim) {
-    int n;
-    for (n = 0; (*tokens++ = strtok(str, delim)); ++n, str = NULL);
-    return n;
+uint64_t load_8_bytes(const char* text, const size_t i, const size_t size) {
+    uint64_t chunk = 0;
+    memcpy(&chunk, text + i, size - i < 8 ? size - i : 8);
+    return chunk;
 }
 
-void print_tokens(char** tokens, int n) {
-    while (n--) printf("%s\n", *tokens++);
+// Parses the integers 8 bytes at a time (SWAR): a mask gives the number of
+// digits, then the digits are combined in pairs, fours and eights with
+// three multiplications instead of one per digit. Assumes a little endian
+// host, so text[i] is the lowest byte of the chunk.
+int parse_data_array(const char* text, const size_t size) {
+    // Every value takes at least one digit and one separator.
+    data_array = malloc(sizeof(int16_t) * (size / 2 + 1));
+    if (data_array == NULL) {
+        fprintf(stderr, "parse_data_array: error, malloc failed\n");
+        return NOT_OK;
+    }
+
+    size_t n = 0;
+    size_t i = 0;
+    while (i < size) {
+        const char c = text[i];
+        if (c == ',' || c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+            ++i;
+            continue;
+        }
+        int negative = c == '-';
+        if (negative) ++i;
+        if (i == size) break;
+
+        uint64_t chunk = load_8_bytes(text, i, size);
+        // A byte is a digit when its high nibble is 3 and adding 6 to it
+        // does not carry into the high nibble. Carries between bytes only
+        // start after the first non-digit, those bytes are not used.
+        uint64_t not_digit = ((chunk & 0xF0F0F0F0F0F0F0F0ULL) ^
+                              0x3030303030303030ULL) |
+                             (((chunk + 0x0606060606060606ULL) &
+                               0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL);
+        int digits = not_digit ? __builtin_ctzll(not_digit) / 8 : 8;
+        // int16 values have at most 5 digits.
+        if (digits == 0 || digits > 5) {
+            fprintf(stderr, "parse_data_array: error, invalid value at"
+                    " byte %zu\n", i);
+            return NOT_OK;
+        }
+
+        // Move the digits to the top bytes, the lower bytes become 0.
+        uint64_t value = (chunk - 0x3030303030303030ULL) << (8 * (8 - digits));
+        value = (value * 10 + (value >> 8)) & 0x00FF00FF00FF00FFULL;
+        value = (value * 100 + (value >> 16)) & 0x0000FFFF0000FFFFULL;
+        value = (value * 10000 + (value >> 32)) & 0x00000000FFFFFFFFULL;
+
+        if (value > (uint64_t) INT16_MAX + negative) {
+            fprintf(stderr, "parse_data_array: error, value at byte %zu"
+                    " does not fit in an int16_t\n", i);
+            return NOT_OK;
+        }
+        data_array[n++] = (int16_t) (negative ? -(int64_t) value :
+                                                (int64_t) value);
+        i += digits;
+    }
+
+    data_array_size = n;
+    return OK;
 }
 
 void print_ints(int16_t* a, int n) {
@@ -0,0 +1,141 @@
+#include "bluestein.h"
+
+// Used in allocation of internal state for fourier or inverse fourier
+// transform.
+#define FOURIER 0
+#define INVERSE_FOURIER 1
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// kissfft has specialised butterflies for these factors
+#define FASTEST_FACTOR 5
+
+double estimateKissFFTCost(size_t nfft);
+
+// Whether a transform of size nfft is estimated to be faster with
+// Bluestein's algorithm than with kissfft directly.
+bool needsBluestein(size_t nfft) {
+#ifdef FIXED_POINT
+    // The chirp needs more precision than the fixed-point scalars have
+    return false;
+#endif /* FIXED_POINT */
+    if (nfft < 2) return false;
+
+    // Three transforms of size mfft plus three element-wise products
+    size_t mfft = kiss_fft_next_fast_size(2 * nfft - 1);
+    double bluesteinCost = 3 * estimateKissFFTCost(mfft) + 3.0 * mfft;
+    return bluesteinCost < estimateKissFFTCost(nfft);
+}
+
+// Rough amount of complex multiplications kissfft does for size nfft: 
+// every stage costs nfft times the radix for the generic butterfly, the
+// specialised butterflies (radix 2 to 5) are counted as cost 1.
+double estimateKissFFTCost(size_t nfft) {
+    double cost = 0;
+
+    size_t remaining = nfft;
+    for (size_t p = 2; p * p <= remaining; p++) {
+        while (remaining % p == 0) {
+            cost += (double) nfft * ((p <= FASTEST_FACTOR) ? 1 : p);
+            remaining /= p;
+        }
+    }
+    if (remaining > 1) {
+        cost += (double) nfft * ((remaining <= FASTEST_FACTOR) ? 1 : 
+                                                              remaining);
+    }
+    return cost;
+}
+
+void createBluestein(bluestein_t *bluestein, size_t nfft) {
+    const size_t mfft = kiss_fft_next_fast_size(2 * nfft - 1);
+
+    bluestein->fftState = kiss_fft_alloc(mfft, FOURIER, 0, 0);
+    bluestein->ifftState = kiss_fft_alloc(mfft, INVERSE_FOURIER, 0, 0);
+    bluestein->chirp = malloc(nfft * sizeof(kiss_fft_cpx));
+    bluestein->chirpFourier = malloc(mfft * sizeof(kiss_fft_cpx));
+    bluestein->work = malloc(mfft * sizeof(kiss_fft_cpx));
+    bluestein->workFourier = malloc(mfft * sizeof(kiss_fft_cpx));
+
+    if (bluestein->fftState == NULL || bluestein->ifftState == NULL ||
+        bluestein->chirp == NULL || bluestein->chirpFourier == NULL ||
+        bluestein->work == NULL || bluestein->workFourier == NULL) {
+        printf("Error in 'createBluestein': malloc failed to allocate a"
+               " plan for %zu samples.\n", nfft);
+        exit(EXIT_FAILURE);
+    }
+
+    // n^2 is taken modulo 2*nfft so the angle stays small and precise
+    for (size_t n = 0; n < nfft; n++) {
+        unsigned long long square = (unsigned long long) n * n % (2 * nfft);
+        double angle = -M_PI * (double) square / (double) nfft;
+        bluestein->chirp[n].r = cos(angle);
+        bluestein->chirp[n].i = sin(angle);
+    }
+
+    // The convolution filter is conj(chirp[|m|]) for -nfft < m < nfft,
+    // negative indices wrap around to the end of the mfft values
+    memset(bluestein->work, 0, mfft * sizeof(kiss_fft_cpx));
+    for (size_t n = 0; n < nfft; n++) {
+        bluestein->work[n].r = bluestein->chirp[n].r;
+        bluestein->work[n].i = -bluestein->chirp[n].i;
+        if (n > 0) bluestein->work[mfft - n] = bluestein->work[n];
+    }
+    kiss_fft(bluestein->fftState, bluestein->work, bluestein->chirpFourier);
+    for (size_t m = 0; m < mfft; m++) {
+        bluestein->chirpFourier[m].r /= mfft;
+        bluestein->chirpFourier[m].i /= mfft;
+    }
+
+    bluestein->nfft = nfft;
+    bluestein->mfft = mfft;
+}
+
+// Computes the same (unnormalized) transform of size nfft as kiss_fft 
+// would. The inverse uses ifft(x) = conj(fft(conj(x))).
+void bluesteinFFT(bluestein_t *bluestein, const kiss_fft_cpx *in,
+                  kiss_fft_cpx *out, bool inverse) {
+    const size_t nfft = bluestein->nfft;
+    const size_t mfft = bluestein->mfft;
+    const kiss_fft_cpx *chirp = bluestein->chirp;
+    kiss_fft_cpx *work = bluestein->work;
+    kiss_fft_cpx *workFourier = bluestein->workFourier;
+    const kiss_fft_scalar sign = inverse ? -1 : 1;
+
+    // work = in * chirp, zero padded to mfft values
+    for (size_t n = 0; n < nfft; n++) {
+        kiss_fft_scalar r = in[n].r, i = sign * in[n].i;
+        work[n].r = r * chirp[n].r - i * chirp[n].i;
+        work[n].i = r * chirp[n].i + i * chirp[n].r;
+    }
+    memset(&work[nfft], 0, (mfft - nfft) * sizeof(kiss_fft_cpx));
+
+    // Convolve with the conjugated chirp through the fourier domain
+    kiss_fft(bluestein->fftState, work, workFourier);
+    for (size_t m = 0; m < mfft; m++) {
+        const kiss_fft_cpx a = workFourier[m];
+        const kiss_fft_cpx b = bluestein->chirpFourier[m];
+        workFourier[m].r = a.r * b.r - a.i * b.i;
+        workFourier[m].i = a.r * b.i + a.i * b.r;
+    }
+    kiss_fft(bluestein->ifftState, workFourier, work);
+
+    // out = work * chirp
+    for (size_t k = 0; k < nfft; k++) {
+        out[k].r = work[k].r * chirp[k].r - work[k].i * chirp[k].i;
+        out[k].i = sign * (work[k].r * chirp[k].i + work[k].i * chirp[k].r);
+    }
+}
+
+void freeBluestein(bluestein_t *bluestein) {
+    // free(NULL) is allowed, so an unused bluestein_t can be freed as well
+    free(bluestein->fftState);
+    free(bluestein->ifftState);
+    free(bluestein->chirp);
+    free(bluestein->chirpFourier);
+    free(bluestein->work);
+    free(bluestein->workFourier);
+    *bluestein = (bluestein_t) { 0 };
+}
@@ -0,0 +1,36 @@
+#ifndef BLUESTEIN_H
+#define BLUESTEIN_H
+
+#include "../RTES.h"
+#include "../kissfft/kiss_fft.h"
+
+// Bluestein's (chirp-z) algorithm computes a DFT of any size nfft as a
+// convolution of size mfft >= 2*nfft-1, which has only the fast factors
+// 2, 3 and 5. kissfft handles other prime factors p with an O(nfft*p)
+// generic butterfly, so for a size with a large prime factor (up to 
+// nfft itself) this keeps the transform O(n log n).
+typedef struct {
+    // Size of the transform, 0 if unused
+    size_t nfft;
+    // Size of the convolution
+    size_t mfft;
+    // kissfft states of the fourier and inverse fourier of size mfft
+    kiss_fft_cfg fftState;
+    kiss_fft_cfg ifftState;
+    // nfft values, chirp[n] = exp(-i*pi*n^2/nfft)
+    kiss_fft_cpx *chirp;
+    // mfft values, fourier of the conjugated chirp wrapped around the
+    // end, already divided by mfft to normalize the inverse fourier
+    kiss_fft_cpx *chirpFourier;
+    // Work buffers of mfft values
+    kiss_fft_cpx *work;
+    kiss_fft_cpx *workFourier;
+} bluestein_t;
+
+bool needsBluestein(size_t nfft);
+void createBluestein(bluestein_t *bluestein, size_t nfft);
+void bluesteinFFT(bluestein_t *bluestein, const kiss_fft_cpx *in,
+                  kiss_fft_cpx *out, bool inverse);
+void freeBluestein(bluestein_t *bluestein);
+
+#endif /* BLUESTEIN_H */
@@ -1,28 +1,19 @@
 #include "cancel.h"
 
-void doFFT(sample_t input[], sample_t output[], size_t size, double cancelPercentage);
+void doFFT(fftPlan_t *plan, sample_t input[], sample_t output[],
+           double cancelPercentage);
+void doStreamingCancel(cancelSettings_t *settings);
+void processHop(cancelSettings_t *settings, const sample_t hop[], 
+                size_t length);
+void cancelPlanData(fftPlan_t *plan, double cancelPercentage);
 
 /***** Copied from main.c non-realtime *****/
-// Used in allocation of internal state for fourier or inverse fourier
-// transform.
-#define FOURIER 0
-#define INVERSE_FOURIER 1
-
 // Error codes for use in functions
 enum error_code {
     OK = 0x0000,
     NOT_OK = 0x0001,
 };
 
-// Do inverse Fourier transform and restore the original signal from a fourier
-// transformed signal.
-int ifft_and_restore(const kiss_fft_cfg* state, const kiss_fft_cpx *in,
-        kiss_fft_cpx *out, const int n);
-
-/* Return index of highest absolute real frequency. */
-size_t highest_frequency_real(const kiss_fft_cpx *s, const size_t size);
-/* Return index of highest absolute imaginary frequency. */
-size_t highest_frequency_imag(const kiss_fft_cpx *s, const size_t size);
 /* Cancel x% around the highest absolute frequency in a complex numbered
  * fourier transformed signal.*/
 int cancel_interval(kiss_fft_cpx *s, const size_t size, double percent);
@@ -31,10 +22,8 @@ int cancel_interval(kiss_fft_cpx *s, const size_t size, double percent);
 void vTaskCancel(void *pvParameters) {
     cancelSettings_t *settings = (cancelSettings_t*) pvParameters;
 
-    TickType_t xTimeTaskStarted;
+    TickType_t xTimeTaskStarted = xTaskGetTickCount();
     for (;;) {
-        xTimeTaskStarted = xTaskGetTickCount();
-
         doCancel(settings);
 
         vTaskDelayUntil(&xTimeTaskStarted, settings->base.xTaskPeriod);
@@ -42,105 +31,283 @@ void vTaskCancel(void *pvParameters) {
 }
 
 void doCancel(cancelSettings_t *settings) {
-    size_t size = settings->inBuffer->used;
-    if (size == 0) return;
-
-    /* Prepare input and output arrays */    
-    sample_t *input = getNewEmptyArray(size);
-    sample_t *output = getNewEmptyArray(size);
+    if (settings->mode == CANCEL_MODE_STREAMING) {
+        doStreamingCancel(settings);
+        return;
+    }
 
-    /* Copies the contents of inBuffer to array input */
-    copyArrayFromBuffer(input, settings->inBuffer, size, 0);
+    size_t size = usedInBuffer(settings->inBuffer);
+    if (size == 0) return;
+    traceJobArgument("samples", size);
+
+    /* Get the contents of inBuffer as one array, this only copies if the 
+       contents are not contiguous in memory */
+    sample_t *inputCopy;
+    sample_t *input = getContiguousFromBuffer(settings->inBuffer, size, 0,
+                                              &inputCopy);
+
+    /* Write the output directly into outBuffer if the free room is
+       contiguous in memory, otherwise use a separate array */
+    sample_t *output = getWriteView(settings->outBuffer, size);
+    sample_t *outputCopy = NULL;
+    if (output == NULL) {
+        output = outputCopy = getNewEmptyArray(size);
+    }
     
     /* Perform FFT on the array input, put result in array output */
-    doFFT(input, output, size, settings->cancelPercentage);
+    /* A real plan of size n uses a complex transform of size n/2
+       internally, which kiss_fftr can not replace by Bluestein's 
+       algorithm, so the complex plan is used for those sizes */
+    bool real = settings->realFFT && size % 2 == 0 &&
+                !needsBluestein(size / 2);
+    doFFT(getFFTPlan(&settings->fftPlans, size, real), input, output,
+          settings->cancelPercentage);
     
-    /* Copy array output to outBuffer */
-    copyBufferFromArray(settings->outBuffer, output, size);
+    /* Add the output to outBuffer, each cancelling sample has the tag of
+       the sample of the noise it cancels */
+    tagBufferFrom(settings->outBuffer, settings->inBuffer, size, 0);
+    if (outputCopy == NULL) {
+        commitToBuffer(settings->outBuffer, size);
+    } else {
+        copyBufferFromArray(settings->outBuffer, outputCopy, size);
+    }
 
-    /* Clear inBuffer and free the input & output arrays */
+    /* Clear inBuffer and free the arrays if they were needed */
     removeFromBuffer(settings->inBuffer, size);
-    free(input);
-    free(output);
+    free(inputCopy);
+    free(outputCopy);
 }
 
-void doFFT(sample_t input[], sample_t output[], size_t size, double cancelPercentage) {
-    kiss_fft_cpx *cx_cancelling_segment = (kiss_fft_cpx*)malloc(size * sizeof(kiss_fft_cpx));
+void makeConjugateSymmetric(kiss_fft_cpx *s, size_t size);
 
-    /* State buffers used by kissfft */
-    kiss_fft_cfg fft_state = kiss_fft_alloc(size, FOURIER, 0, 0);
-    kiss_fft_cfg ifft_state = kiss_fft_alloc(size, INVERSE_FOURIER, 0, 0);
+void doFFT(fftPlan_t *plan, sample_t input[], sample_t output[],
+           double cancelPercentage) {
+    const size_t size = plan->nfft;
 
     /* 1. Get the noise segment from the input array */
-	kiss_fft_cpx *cx_noise_segment = (kiss_fft_cpx*)malloc(size * sizeof(kiss_fft_cpx));
+    if (plan->real) {
+        for (size_t i = 0; i < size; i++) {
+            plan->realTimeData[i] = sampleToScalar(input[i]);
+        }
+    } else {
+        for (size_t i = 0; i < size; i++) {
+            plan->timeData[i].r = sampleToScalar(input[i]); // Real
+            plan->timeData[i].i = 0; // Imaginary
+        }
+    }
+
+    /* 2-4. */
+    cancelPlanData(plan, cancelPercentage);
+
+    /* Copy the cancelling noise to the output array, the inverse
+       transform still has to be scaled back by size */
     for (size_t i = 0; i < size; i++) {
-        cx_noise_segment[i].r = input[i]; // Real
-        cx_noise_segment[i].i = 0.0; // Imaginary
+        kiss_fft_scalar value = plan->real ? plan->realTimeData[i] : 
+                                             plan->timeData[i].r;
+        output[i] = scalarToSample(restoreInverseScale(value, size));
+    }
+}
+
+/* Replaces the noise in the time domain buffer of the plan by the
+   cancelling noise, which still has to be restored with 
+   restoreInverseScale(). A real plan
+   uses kiss_fftr which only computes the nfft/2+1 bins of the 
+   half-spectrum. The other bins are the complex conjugates of these for 
+   real input, so they are not needed. */
+void cancelPlanData(fftPlan_t *plan, double cancelPercentage) {
+    const size_t size = plan->nfft;
+    kiss_fft_cpx *cx_noise_segment_fourier = plan->freqData;
+
+    if (plan->real) {
+        /* 2. Compute fourier to get the noise frequencies */
+        kiss_fftr(plan->fftrState, plan->realTimeData, 
+                  cx_noise_segment_fourier);
+
+        /* 3. Cancel the highest absolute frequencies of the half-spectrum */
+        cancel_interval(cx_noise_segment_fourier, size / 2 + 1, 
+                        cancelPercentage);
+
+        /* 4. Compute inverse fourier to generate cancelling noise */
+        kiss_fftri(plan->ifftrState, cx_noise_segment_fourier, 
+                   plan->realTimeData);
+        return;
     }
 
     /* 2. Compute fourier to get the noise frequencies */
-	kiss_fft_cpx* cx_noise_segment_fourier = (kiss_fft_cpx*)malloc(size * sizeof(kiss_fft_cpx));
-    kiss_fft(fft_state, cx_noise_segment, cx_noise_segment_fourier);
+    planFFT(plan, plan->timeData, cx_noise_segment_fourier);
+#ifdef FIXED_POINT
+    /* The rounding of the fixed-point transform breaks ties between 
+       mirrored bins differently than the floating-point one */
+    makeConjugateSymmetric(cx_noise_segment_fourier, size);
+#else
+    if (plan->bluestein.nfft != 0) {
+        makeConjugateSymmetric(cx_noise_segment_fourier, size);
+    }
+#endif /* FIXED_POINT */
 
     /* 3. Perform algorithm to cancel only the highest absolute frequencies of the
            fourier transformed signal. */
     cancel_interval(cx_noise_segment_fourier, size, cancelPercentage);
 
-    /* 4. Compute inverse fourier to generate cancelling noise */
-    ifft_and_restore(&ifft_state, cx_noise_segment_fourier, 
-                     cx_cancelling_segment, size);
-
-    /* Copy the cancelling noise to the output array */
-    for (size_t i = 0; i < size; i++) {
-        output[i] = cx_cancelling_segment[i].r;
-    }
-    
-    /* Free all used resources */
-    free(fft_state);
-    free(ifft_state);
-	free(cx_cancelling_segment);
-	free(cx_noise_segment);
-	free(cx_noise_segment_fourier);
+    /* 4. Compute inverse fourier to generate cancelling noise, the time
+          domain buffer of the plan is reused for the result */
+    planIFFT(plan, cx_noise_segment_fourier, plan->timeData);
 }
 
-/***** Functions copied from main.c non-realtime *****/
-
-int ifft_and_restore(const kiss_fft_cfg* state, const kiss_fft_cpx *in,
-        kiss_fft_cpx *out, const int n) {
-    // Perform the kiss fft inverse fourier transform.
-    kiss_fft(*state, in, out);
-    // We have to divide by n to actually restore the original signal, as
-    // the numbers at every index of the signal are multiplied by n. I am
-    // not sure why the numbers are multiplied.
-    for (int i = 0; i < n; ++i) {
-        out[i].r /= n;
-        out[i].i /= n;
+/* The fourier transform of real input has s[size-k] == conj(s[k]). The
+   rounding errors of Bluestein's algorithm break this symmetry, which would
+   make cancel_interval pick the mirrored bin of an equal pair. */
+void makeConjugateSymmetric(kiss_fft_cpx *s, size_t size) {
+    s[0].i = 0;
+    for (size_t k = 1; k <= size / 2; k++) {
+#ifdef FIXED_POINT
+        /* The sum of two 32 bit values may not fit in 32 bits */
+        const kiss_fft_scalar r = ((int64_t) s[k].r + s[size - k].r) / 2;
+        const kiss_fft_scalar i = ((int64_t) s[k].i - s[size - k].i) / 2;
+#else
+        const kiss_fft_scalar r = (s[k].r + s[size - k].r) / 2;
+        const kiss_fft_scalar i = (s[k].i - s[size - k].i) / 2;
+#endif /* FIXED_POINT */
+        s[k].r = s[size - k].r = r;
+        s[k].i = i;
+        s[size - k].i = -i;
     }
-    return OK;
 }
 
-/* Return index of highest absolute real frequency. */
-size_t highest_frequency_real(const kiss_fft_cpx *s, const size_t size) {
-    size_t current_highest = 0;
-    for (int i = 1; i < size; ++i) {
-        if (fabs(s[i].r) > fabs(s[current_highest].r)) {
-            current_highest = i;
+/* Cancels the noise in frames of frameSize samples every hopSize samples,
+   so the cancelling noise starts frameSize - hopSize samples after the 
+   begin of the noise instead of after its end. */
+void doStreamingCancel(cancelSettings_t *settings) {
+    stft_t *stft = &settings->stft;
+    if (stft->frameSize == 0) {
+        createSTFT(stft, settings->frameSize, settings->hopSize);
+    }
+    const size_t hopSize = stft->hopSize;
+    sample_t *hop = stft->hopSamples;
+    /* Loaded once and before the inBuffer, Recognize forwards the last
+       segment before it publishes the size, so then every sample of the
+       noise is in the inBuffer. The samples after it belong to the next
+       noise and are left there. */
+    const size_t noiseSize = atomic_load_explicit(&settings->endedNoiseSize,
+                                                  memory_order_acquire);
+    size_t samples = 0;
+    while (usedInBuffer(settings->inBuffer) >= hopSize &&
+           (noiseSize == 0 || stft->samplesIn + hopSize <= noiseSize)) {
+        if (stft->samplesIn == 0) {
+            settings->noiseTag = tagOfBuffer(settings->inBuffer, 0);
         }
+        copyArrayFromBuffer(hop, settings->inBuffer, hopSize, 0);
+        removeFromBuffer(settings->inBuffer, hopSize);
+        processHop(settings, hop, hopSize);
+        samples += hopSize;
+    }
+    if (samples > 0) traceJobArgument("samples", samples);
+
+    if (noiseSize == 0) return;
+
+    /* The noise has ended, the last part of a hop is padded with zeros
+       and zeros are added until all samples of the noise are output. Less
+       than a hop of the noise is left, else the loop would have taken it. */
+    const size_t rest = noiseSize - stft->samplesIn;
+    if (rest >= hopSize || usedInBuffer(settings->inBuffer) < rest) {
+        printf("Error in 'doStreamingCancel': %zu samples of the noise of"
+               " %zu samples are left.\n", rest, noiseSize);
+        exit(EXIT_FAILURE);
     }
-    return current_highest;
+    if (stft->samplesIn == 0 && rest > 0) {
+        settings->noiseTag = tagOfBuffer(settings->inBuffer, 0);
+    }
+    copyArrayFromBuffer(hop, settings->inBuffer, rest, 0);
+    removeFromBuffer(settings->inBuffer, rest);
+    memset(&hop[rest], 0, (hopSize - rest) * sizeof(sample_t));
+    if (rest > 0) processHop(settings, hop, rest);
+
+    memset(hop, 0, hopSize * sizeof(sample_t));
+    while (stft->samplesOut < stft->samplesIn) {
+        processHop(settings, hop, 0);
+    }
+
+    resetSTFT(stft);
+    /* Recognize may search for the next noise now */
+    atomic_store_explicit(&settings->endedNoiseSize, 0,
+                          memory_order_release);
 }
 
-/* Return index of highest absolute imaginary frequency. */
-size_t highest_frequency_imag(const kiss_fft_cpx *s, const size_t size) {
-    size_t current_highest = 0;
-    for (int i = 1; i < size; ++i) {
-        if (fabs(s[i].i) > fabs(s[current_highest].i)) {
-            current_highest = i;
+/* Adds a hop of new samples, of which length belong to the noise, to the
+   history and cancels the noise in the resulting frame. Outputs the hop of
+   cancelling noise that is complete after this frame, through the 
+   hopSamples buffer, so hop may be that buffer. */
+void processHop(cancelSettings_t *settings, const sample_t hop[], 
+                size_t length) {
+    stft_t *stft = &settings->stft;
+    const size_t frameSize = stft->frameSize;
+    const size_t hopSize = stft->hopSize;
+    fftPlan_t *plan = getFFTPlan(&settings->fftPlans, frameSize,
+                                 settings->realFFT && frameSize % 2 == 0 &&
+                                 !needsBluestein(frameSize / 2));
+
+    memmove(stft->history, &stft->history[hopSize], 
+            (frameSize - hopSize) * sizeof(kiss_fft_scalar));
+    for (size_t i = 0; i < hopSize; i++) {
+        stft->history[frameSize - hopSize + i] = sampleToScalar(hop[i]);
+    }
+    stft->samplesIn += length;
+
+    /* Window the frame and replace it by the cancelling noise */
+    for (size_t i = 0; i < frameSize; i++) {
+        kiss_fft_scalar value = multiplyFraction(stft->history[i],
+                                                 stft->analysisWindow[i]);
+        if (plan->real) {
+            plan->realTimeData[i] = value;
+        } else {
+            plan->timeData[i].r = value;
+            plan->timeData[i].i = 0;
         }
     }
-    return current_highest;
+    cancelPlanData(plan, settings->cancelPercentage);
+
+    /* Overlap-add the windowed frame */
+    for (size_t i = 0; i < frameSize; i++) {
+        kiss_fft_scalar value = plan->real ? plan->realTimeData[i] :
+                                             plan->timeData[i].r;
+        stft->overlap[i] += multiplyFraction(
+                                    restoreInverseScale(value, frameSize),
+                                    stft->synthesisWindow[i]);
+    }
+
+    /* The first hopSize values of overlap have all their frames now */
+    size_t outputLength = hopSize;
+    if (stft->hopsToDiscard > 0) {
+        stft->hopsToDiscard--;
+        outputLength = 0;
+    } else if (outputLength > stft->samplesIn - stft->samplesOut) {
+        outputLength = stft->samplesIn - stft->samplesOut;
+    }
+    sample_t *output = stft->hopSamples;
+    for (size_t i = 0; i < outputLength; i++) {
+        output[i] = scalarToSample(stft->overlap[i]);
+    }
+    /* The noise is contiguous, so its samplesOut-th sample follows the
+       first one */
+    tagBuffer(settings->outBuffer, 
+              settings->noiseTag.inputIndex + stft->samplesOut,
+              settings->noiseTag.event);
+    copyBufferFromArray(settings->outBuffer, output, outputLength);
+    stft->samplesOut += outputLength;
+
+    memmove(stft->overlap, &stft->overlap[hopSize],
+            (frameSize - hopSize) * sizeof(kiss_fft_scalar));
+    memset(&stft->overlap[frameSize - hopSize], 0, 
+           hopSize * sizeof(kiss_fft_scalar));
+}
+
+void freeCancel(cancelSettings_t *settings) {
+    freeFFTPlanCache(&settings->fftPlans);
+    freeSTFT(&settings->stft);
 }
 
+/***** Functions copied from main.c non-realtime *****/
+
 /* Set x% around the absolute highest frequency to zero. */
 int cancel_interval(kiss_fft_cpx *s, const size_t size, double percent) {
     size_t interval, hfreq_idx_re, hfreq_idx_im;
@@ -149,9 +316,9 @@ int cancel_interval(kiss_fft_cpx *s, const size_t size, double percent) {
     if (percent < 0 || percent > 100) return NOT_OK;
     interval = percent/100.0 * size;
 
-    /* Get the index of the highest frequency of the real and imaginary parts.*/
-    hfreq_idx_re = highest_frequency_real(s, size);
-    hfreq_idx_im = highest_frequency_imag(s, size);
+    /* Get the index of the highest frequency of the real and imaginary
+       parts, both in one pass over the spectrum. */
+    findSpectrumPeaks(s, size, &hfreq_idx_re, &hfreq_idx_im);
 
     /* Get begin and end intervals. */
     beg_re = hfreq_idx_re - interval;
@@ -165,20 +332,7 @@ int cancel_interval(kiss_fft_cpx *s, const size_t size, double percent) {
     if (end_im > size) end_im = size;
 
     /* Set frequencies to zero */
-    for (int i = beg_re; i < end_re; ++i) {
-        s[i].r = 0.0;
-    }
-    for (int i = beg_im; i < end_im; ++i) {
-        s[i].i = 0.0;
-    }
-
-    /* /1* Invert frequencies *1/ */
-    /* for (int i = beg_re; i < end_re; ++i) { */
-    /*     s[i].r = -s[i].r; */
-    /* } */
-    /* for (int i = beg_im; i < end_im; ++i) { */
-    /*     s[i].i = -s[i].i; */
-    /* } */
+    maskSpectrum(s, beg_re, end_re, beg_im, end_im);
 
     return OK;
 }
@@ -9,16 +9,70 @@
 #include "../kissfft/kiss_fft.c"
 #endif /* USE_TEMPFREERTOS */
 
+#include "fftplan.h"
+#ifndef USE_TEMPFREERTOS
+#include "fftplan.c"
+#endif /* USE_TEMPFREERTOS */
+
+#include "spectrum.h"
+#ifndef USE_TEMPFREERTOS
+#include "spectrum.c"
+#endif /* USE_TEMPFREERTOS */
+
+#include "stft.h"
+#ifndef USE_TEMPFREERTOS
+#include "stft.c"
+#endif /* USE_TEMPFREERTOS */
+
+#include "../trace.h"
+#ifndef USE_TEMPFREERTOS
+#include "../trace.c"
+#endif /* USE_TEMPFREERTOS */
+
 #include "../data.h"
 
+#include <stdatomic.h>
+
+typedef enum {
+    // Cancel a whole noise at once after Recognize found its end
+    CANCEL_MODE_EVENT,
+    // Cancel the noise while it is still going on, in overlapping frames
+    // of frameSize samples every hopSize samples. Recognize forwards every
+    // segment of the noise and publishes its size after the last one.
+    CANCEL_MODE_STREAMING
+} cancelMode_t;
+
 typedef struct {
     baseSettings_t base;
     buffer_t *inBuffer;
     buffer_t *outBuffer;
     double cancelPercentage; //range [0, 100]
+    // Use the real FFT (kiss_fftr) for noise of an even size, 
+    // cancelPercentage then applies to the nfft/2+1 bins of the
+    // half-spectrum instead of all nfft bins of the complex spectrum
+    bool realFFT;
+    // FFT states and work buffers of the recently used noise sizes, so
+    // these are not allocated and computed again for every noise
+    fftPlanCache_t fftPlans;
+    cancelMode_t mode;
+    // Frame and hop size of CANCEL_MODE_STREAMING, frameSize has to be a
+    // multiple of at least two times hopSize
+    size_t frameSize;
+    size_t hopSize;
+    // Samples Recognize forwarded of the noise once it has ended, 0 while
+    // it is going on. Stored by Recognize (release) after the last segment,
+    // the streaming canceller outputs exactly that many samples of noise
+    // and stores 0 again (release) when it is done.
+    _Atomic size_t endedNoiseSize;
+    // Overlap-add state of CANCEL_MODE_STREAMING, created by the first call
+    stft_t stft;
+    // Tag of the first sample of the noise in the inBuffer when streaming,
+    // the cancelling noise is tagged from it (when the buffers are traced)
+    sampleTag_t noiseTag;
 } cancelSettings_t;
 
 void vTaskCancel(void *pvParameters);
 void doCancel(cancelSettings_t *settings);
+void freeCancel(cancelSettings_t *settings);
 
 #endif /* CANCEL_H */
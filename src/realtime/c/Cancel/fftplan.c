@@ -0,0 +1,162 @@
+#include "fftplan.h"
+
+// Used in allocation of internal state for fourier or inverse fourier
+// transform.
+#define FOURIER 0
+#define INVERSE_FOURIER 1
+
+void createFFTPlan(fftPlan_t *plan, size_t nfft, bool real);
+void freeFFTPlan(fftPlan_t *plan);
+
+// Returns the complex or real plan for transforms of size nfft, the plan is
+// created (and the least recently used plan freed) if the cache does not
+// contain it. The plan stays valid until the next call to getFFTPlan().
+fftPlan_t *getFFTPlan(fftPlanCache_t *cache, size_t nfft, bool real) {
+    fftPlan_t *leastRecent = &cache->plans[0];
+
+    cache->clock++;
+    for (size_t i = 0; i < FFT_PLAN_CACHE_SIZE; i++) {
+        fftPlan_t *plan = &cache->plans[i];
+        if (plan->nfft == nfft && plan->real == real) {
+            plan->lastUsed = cache->clock;
+            return plan;
+        }
+        if (plan->lastUsed < leastRecent->lastUsed) leastRecent = plan;
+    }
+
+    freeFFTPlan(leastRecent);
+    createFFTPlan(leastRecent, nfft, real);
+    leastRecent->lastUsed = cache->clock;
+    return leastRecent;
+}
+
+void freeFFTPlanCache(fftPlanCache_t *cache) {
+    for (size_t i = 0; i < FFT_PLAN_CACHE_SIZE; i++) {
+        freeFFTPlan(&cache->plans[i]);
+    }
+    cache->clock = 0;
+}
+
+// Fourier transform of the nfft values in of a complex plan.
+void planFFT(fftPlan_t *plan, const kiss_fft_cpx *in, kiss_fft_cpx *out) {
+    if (plan->bluestein.nfft != 0) {
+        bluesteinFFT(&plan->bluestein, in, out, false);
+    } else {
+        kiss_fft(plan->fftState, in, out);
+    }
+}
+
+// Inverse fourier transform of the nfft values in of a complex plan, like
+// kiss_fft the result is not divided by nfft.
+void planIFFT(fftPlan_t *plan, const kiss_fft_cpx *in, kiss_fft_cpx *out) {
+    if (plan->bluestein.nfft != 0) {
+        bluesteinFFT(&plan->bluestein, in, out, true);
+    } else {
+        kiss_fft(plan->ifftState, in, out);
+    }
+}
+
+kiss_fft_scalar sampleToScalar(sample_t sample) {
+#ifdef FIXED_POINT
+    return sample * (1 << FIXED_INPUT_SHIFT);
+#else
+    return sample;
+#endif /* FIXED_POINT */
+}
+
+// The floating-point build truncates like the original cast did, the
+// fixed-point build rounds while it removes the input shift.
+sample_t scalarToSample(kiss_fft_scalar value) {
+#ifdef FIXED_POINT
+    return (value + (1 << (FIXED_INPUT_SHIFT - 1))) >> FIXED_INPUT_SHIFT;
+#else
+    return value;
+#endif /* FIXED_POINT */
+}
+
+// An inverse of a fourier transform of kissfft gives nfft times the 
+// original values in the floating-point build, and the original values
+// divided by nfft in the fixed-point build.
+kiss_fft_scalar restoreInverseScale(kiss_fft_scalar value, size_t nfft) {
+#ifdef FIXED_POINT
+    int64_t restored = (int64_t) value * (int64_t) nfft;
+    if (restored > INT32_MAX) return INT32_MAX;
+    if (restored < INT32_MIN) return INT32_MIN;
+    return restored;
+#else
+    return value / nfft;
+#endif /* FIXED_POINT */
+}
+
+// Fractions in [-1, 1], like window values, are Q31 in the fixed-point
+// build. Only used when setting up, so it may use floating-point.
+kiss_fft_scalar fractionToScalar(double fraction) {
+#ifdef FIXED_POINT
+    if (fraction >= 1.0) return INT32_MAX;
+    if (fraction <= -1.0) return -INT32_MAX;
+    return (kiss_fft_scalar) lround(fraction * INT32_MAX);
+#else
+    return fraction;
+#endif /* FIXED_POINT */
+}
+
+kiss_fft_scalar multiplyFraction(kiss_fft_scalar value, 
+                                 kiss_fft_scalar fraction) {
+#ifdef FIXED_POINT
+    return ((int64_t) value * fraction + (1LL << 30)) >> 31;
+#else
+    return value * fraction;
+#endif /* FIXED_POINT */
+}
+
+void createFFTPlan(fftPlan_t *plan, size_t nfft, bool real) {
+    bool allocated;
+
+    if (real) {
+        if (nfft % 2 != 0) {
+            printf("Error in 'createFFTPlan': a real plan needs an even"
+                   " size, got %zu samples.\n", nfft);
+            exit(EXIT_FAILURE);
+        }
+        plan->fftrState = kiss_fftr_alloc(nfft, FOURIER, 0, 0);
+        plan->ifftrState = kiss_fftr_alloc(nfft, INVERSE_FOURIER, 0, 0);
+        plan->realTimeData = malloc(nfft * sizeof(kiss_fft_scalar));
+        plan->freqData = malloc((nfft / 2 + 1) * sizeof(kiss_fft_cpx));
+        allocated = plan->fftrState != NULL && plan->ifftrState != NULL &&
+                    plan->realTimeData != NULL && plan->freqData != NULL;
+    } else {
+        if (needsBluestein(nfft)) {
+            // createBluestein() exits itself if it fails to allocate
+            createBluestein(&plan->bluestein, nfft);
+        } else {
+            plan->fftState = kiss_fft_alloc(nfft, FOURIER, 0, 0);
+            plan->ifftState = kiss_fft_alloc(nfft, INVERSE_FOURIER, 0, 0);
+        }
+        plan->timeData = malloc(nfft * sizeof(kiss_fft_cpx));
+        plan->freqData = malloc(nfft * sizeof(kiss_fft_cpx));
+        allocated = (plan->bluestein.nfft != 0 || 
+                     (plan->fftState != NULL && plan->ifftState != NULL)) &&
+                    plan->timeData != NULL && plan->freqData != NULL;
+    }
+
+    if (!allocated) {
+        printf("Error in 'createFFTPlan': malloc failed to allocate a plan"
+               " for %zu samples.\n", nfft);
+        exit(EXIT_FAILURE);
+    }
+    plan->nfft = nfft;
+    plan->real = real;
+}
+
+void freeFFTPlan(fftPlan_t *plan) {
+    // free(NULL) is allowed, so unused plans can be freed as well
+    free(plan->fftState);
+    free(plan->ifftState);
+    freeBluestein(&plan->bluestein);
+    kiss_fftr_free(plan->fftrState);
+    kiss_fftr_free(plan->ifftrState);
+    free(plan->timeData);
+    free(plan->realTimeData);
+    free(plan->freqData);
+    *plan = (fftPlan_t) { 0 };
+}
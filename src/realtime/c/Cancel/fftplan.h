@@ -0,0 +1,71 @@
+#ifndef FFTPLAN_H
+#define FFTPLAN_H
+
+#include "../RTES.h"
+#include "../kissfft/kiss_fft.h"
+#include "../kissfft/tools/kiss_fftr.h"
+#include "bluestein.h"
+#ifndef USE_TEMPFREERTOS
+#include "../kissfft/tools/kiss_fftr.c"
+#include "bluestein.c"
+#endif /* USE_TEMPFREERTOS */
+
+#ifdef FIXED_POINT
+// Samples are 16 bit values in a sample_t. The fixed-point transforms
+// divide by nfft to prevent overflows, so the samples are shifted up to
+// keep their precision, which leaves them a Q15 fraction of 2^31.
+#define FIXED_INPUT_SHIFT 15
+#endif /* FIXED_POINT */
+
+// Amount of transform sizes an fftPlanCache_t keeps, when a new size is
+// needed the least recently used plan is replaced.
+#define FFT_PLAN_CACHE_SIZE 4
+
+typedef struct {
+    // Size of the transforms, 0 if the plan is not in use
+    size_t nfft;
+    // Real plans use kiss_fftr on real input and only keep the nfft/2+1
+    // non-redundant bins of the spectrum, nfft has to be even for these
+    bool real;
+    // Value of the clock of the cache when the plan was last used
+    unsigned long lastUsed;
+    // kissfft states (twiddle factors) of the fourier and inverse fourier
+    // of a complex plan
+    kiss_fft_cfg fftState;
+    kiss_fft_cfg ifftState;
+    // Complex plans of sizes with large prime factors use Bluestein's
+    // algorithm instead of fftState and ifftState, see needsBluestein()
+    bluestein_t bluestein;
+    // kiss_fftr states of the fourier and inverse fourier of a real plan
+    kiss_fftr_cfg fftrState;
+    kiss_fftr_cfg ifftrState;
+    // Work buffer of nfft values for the time domain, timeData for a 
+    // complex plan and realTimeData for a real plan
+    kiss_fft_cpx *timeData;
+    kiss_fft_scalar *realTimeData;
+    // Work buffer for the frequency domain of nfft (complex plan) or
+    // nfft/2+1 (real plan) values
+    kiss_fft_cpx *freqData;
+} fftPlan_t;
+
+// A zero-initialized fftPlanCache_t is an empty cache.
+typedef struct {
+    fftPlan_t plans[FFT_PLAN_CACHE_SIZE];
+    unsigned long clock;
+} fftPlanCache_t;
+
+fftPlan_t *getFFTPlan(fftPlanCache_t *cache, size_t nfft, bool real);
+void freeFFTPlanCache(fftPlanCache_t *cache);
+void planFFT(fftPlan_t *plan, const kiss_fft_cpx *in, kiss_fft_cpx *out);
+void planIFFT(fftPlan_t *plan, const kiss_fft_cpx *in, kiss_fft_cpx *out);
+
+// Conversions between samples and kiss_fft_scalar values that hide the 
+// difference between the floating-point and the FIXED_POINT build
+kiss_fft_scalar sampleToScalar(sample_t sample);
+sample_t scalarToSample(kiss_fft_scalar value);
+kiss_fft_scalar restoreInverseScale(kiss_fft_scalar value, size_t nfft);
+kiss_fft_scalar fractionToScalar(double fraction);
+kiss_fft_scalar multiplyFraction(kiss_fft_scalar value, 
+                                 kiss_fft_scalar fraction);
+
+#endif /* FFTPLAN_H */
@@ -0,0 +1,244 @@
+#include "spectrum.h"
+
+#include <stdint.h>
+
+// The vector kernels reinterpret the spectrum as floats and use 32 bit
+// bin indices, which is all the realtime sizes need.
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && \
+    !defined(FIXED_POINT) && !defined(USE_SIMD)
+#define SPECTRUM_X86
+#include <immintrin.h>
+#endif
+
+// llabs() because the absolute value of INT32_MIN does not fit in 32 bits
+#ifdef FIXED_POINT
+#define SCALAR_ABS(x) llabs(x)
+#else
+#define SCALAR_ABS(x) fabs(x)
+#endif /* FIXED_POINT */
+
+#ifdef SPECTRUM_X86
+_Static_assert(sizeof(kiss_fft_cpx) == 2 * sizeof(float),
+               "the vector kernels need a float kiss_fft_scalar");
+#endif
+
+void findSpectrumPeaksScalar(const kiss_fft_cpx *s, size_t begin, 
+                             size_t size, size_t *peakReal, 
+                             size_t *peakImag);
+void maskSpectrumScalar(kiss_fft_cpx *s, size_t begin, size_t end,
+                        size_t begReal, size_t endReal,
+                        size_t begImag, size_t endImag);
+void reducePeaks(const float *values, const int32_t *bins, size_t lanes,
+                 size_t *peakReal, size_t *peakImag);
+
+#ifdef SPECTRUM_X86
+void findSpectrumPeaksSSE2(const kiss_fft_cpx *s, size_t size,
+                           size_t *peakReal, size_t *peakImag);
+void findSpectrumPeaksAVX2(const kiss_fft_cpx *s, size_t size,
+                           size_t *peakReal, size_t *peakImag);
+void maskSpectrumSSE2(kiss_fft_cpx *s, size_t begin, size_t end,
+                      size_t begReal, size_t endReal,
+                      size_t begImag, size_t endImag);
+void maskSpectrumAVX2(kiss_fft_cpx *s, size_t begin, size_t end,
+                      size_t begReal, size_t endReal,
+                      size_t begImag, size_t endImag);
+#endif /* SPECTRUM_X86 */
+
+void findSpectrumPeaks(const kiss_fft_cpx *s, size_t size,
+                       size_t *peakReal, size_t *peakImag) {
+    *peakReal = *peakImag = 0;
+    if (size == 0) return;
+
+#ifdef SPECTRUM_X86
+    if (size <= INT32_MAX) {
+        if (__builtin_cpu_supports("avx2")) {
+            findSpectrumPeaksAVX2(s, size, peakReal, peakImag);
+            return;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            findSpectrumPeaksSSE2(s, size, peakReal, peakImag);
+            return;
+        }
+    }
+#endif /* SPECTRUM_X86 */
+    findSpectrumPeaksScalar(s, 1, size, peakReal, peakImag);
+}
+
+void maskSpectrum(kiss_fft_cpx *s, size_t begReal, size_t endReal,
+                  size_t begImag, size_t endImag) {
+    // Only the bins between the first begin and the last end are touched
+    size_t begin = begReal < begImag ? begReal : begImag;
+    size_t end = endReal > endImag ? endReal : endImag;
+    if (begReal >= endReal) begin = begImag;
+    if (begImag >= endImag) begin = begReal;
+    if (begin >= end) return;
+
+#ifdef SPECTRUM_X86
+    if (end <= INT32_MAX) {
+        if (__builtin_cpu_supports("avx2")) {
+            maskSpectrumAVX2(s, begin, end, begReal, endReal, 
+                             begImag, endImag);
+            return;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            maskSpectrumSSE2(s, begin, end, begReal, endReal,
+                             begImag, endImag);
+            return;
+        }
+    }
+#endif /* SPECTRUM_X86 */
+    maskSpectrumScalar(s, begin, end, begReal, endReal, begImag, endImag);
+}
+
+// Continues a scan from bin begin with the peaks found so far.
+void findSpectrumPeaksScalar(const kiss_fft_cpx *s, size_t begin, 
+                             size_t size, size_t *peakReal, 
+                             size_t *peakImag) {
+    size_t real = *peakReal, imag = *peakImag;
+    for (size_t i = begin; i < size; i++) {
+        if (SCALAR_ABS(s[i].r) > SCALAR_ABS(s[real].r)) real = i;
+        if (SCALAR_ABS(s[i].i) > SCALAR_ABS(s[imag].i)) imag = i;
+    }
+    *peakReal = real;
+    *peakImag = imag;
+}
+
+void maskSpectrumScalar(kiss_fft_cpx *s, size_t begin, size_t end,
+                        size_t begReal, size_t endReal,
+                        size_t begImag, size_t endImag) {
+    for (size_t i = begin; i < end; i++) {
+        if (i >= begReal && i < endReal) s[i].r = 0;
+        if (i >= begImag && i < endImag) s[i].i = 0;
+    }
+}
+
+// The vector lanes alternate between real and imaginary parts, every lane
+// holds the first maximum of its own bins. The peak is the highest value
+// of the lanes, and of equal values the one with the lowest bin.
+void reducePeaks(const float *values, const int32_t *bins, size_t lanes,
+                 size_t *peakReal, size_t *peakImag) {
+    size_t best[2] = { 0, 1 };
+    for (size_t lane = 2; lane < lanes; lane++) {
+        size_t *b = &best[lane % 2];
+        if (values[lane] > values[*b] ||
+            (values[lane] == values[*b] && bins[lane] < bins[*b])) {
+            *b = lane;
+        }
+    }
+    *peakReal = bins[best[0]];
+    *peakImag = bins[best[1]];
+}
+
+#ifdef SPECTRUM_X86
+
+// Two bins per vector: [r0 i0 r1 i1]
+__attribute__((target("sse2")))
+void findSpectrumPeaksSSE2(const kiss_fft_cpx *s, size_t size,
+                           size_t *peakReal, size_t *peakImag) {
+    const float *f = (const float *) s;
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128i step = _mm_set1_epi32(2);
+    __m128 best = _mm_set1_ps(-1.0f);
+    __m128i bestBins = _mm_setzero_si128();
+    __m128i bins = _mm_setr_epi32(0, 0, 1, 1);
+
+    size_t i = 0;
+    for (; i + 2 <= size; i += 2) {
+        __m128 value = _mm_and_ps(_mm_loadu_ps(&f[2 * i]), absMask);
+        __m128 higher = _mm_cmpgt_ps(value, best);
+        best = _mm_or_ps(_mm_and_ps(higher, value), 
+                         _mm_andnot_ps(higher, best));
+        __m128i higherBins = _mm_castps_si128(higher);
+        bestBins = _mm_or_si128(_mm_and_si128(higherBins, bins),
+                                _mm_andnot_si128(higherBins, bestBins));
+        bins = _mm_add_epi32(bins, step);
+    }
+
+    float values[4];
+    int32_t laneBins[4];
+    _mm_storeu_ps(values, best);
+    _mm_storeu_si128((__m128i *) laneBins, bestBins);
+    reducePeaks(values, laneBins, 4, peakReal, peakImag);
+    findSpectrumPeaksScalar(s, i, size, peakReal, peakImag);
+}
+
+// Four bins per vector: [r0 i0 r1 i1 r2 i2 r3 i3]
+__attribute__((target("avx2")))
+void findSpectrumPeaksAVX2(const kiss_fft_cpx *s, size_t size,
+                           size_t *peakReal, size_t *peakImag) {
+    const float *f = (const float *) s;
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256i step = _mm256_set1_epi32(4);
+    __m256 best = _mm256_set1_ps(-1.0f);
+    __m256i bestBins = _mm256_setzero_si256();
+    __m256i bins = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m256 value = _mm256_and_ps(_mm256_loadu_ps(&f[2 * i]), absMask);
+        __m256 higher = _mm256_cmp_ps(value, best, _CMP_GT_OQ);
+        best = _mm256_blendv_ps(best, value, higher);
+        bestBins = _mm256_blendv_epi8(bestBins, bins, 
+                                      _mm256_castps_si256(higher));
+        bins = _mm256_add_epi32(bins, step);
+    }
+
+    float values[8];
+    int32_t laneBins[8];
+    _mm256_storeu_ps(values, best);
+    _mm256_storeu_si256((__m256i *) laneBins, bestBins);
+    reducePeaks(values, laneBins, 8, peakReal, peakImag);
+    findSpectrumPeaksScalar(s, i, size, peakReal, peakImag);
+}
+
+// A lane is kept if its bin is outside [beg, end) of its part.
+__attribute__((target("sse2")))
+void maskSpectrumSSE2(kiss_fft_cpx *s, size_t begin, size_t end,
+                      size_t begReal, size_t endReal,
+                      size_t begImag, size_t endImag) {
+    float *f = (float *) s;
+    const __m128i beg = _mm_setr_epi32(begReal, begImag, begReal, begImag);
+    const __m128i stop = _mm_setr_epi32(endReal, endImag, endReal, endImag);
+    const __m128i step = _mm_set1_epi32(2);
+    __m128i bins = _mm_setr_epi32(begin, begin, begin + 1, begin + 1);
+
+    size_t i = begin;
+    for (; i + 2 <= end; i += 2) {
+        __m128i inside = _mm_andnot_si128(_mm_cmplt_epi32(bins, beg),
+                                          _mm_cmplt_epi32(bins, stop));
+        __m128 value = _mm_loadu_ps(&f[2 * i]);
+        _mm_storeu_ps(&f[2 * i], 
+                      _mm_andnot_ps(_mm_castsi128_ps(inside), value));
+        bins = _mm_add_epi32(bins, step);
+    }
+    maskSpectrumScalar(s, i, end, begReal, endReal, begImag, endImag);
+}
+
+__attribute__((target("avx2")))
+void maskSpectrumAVX2(kiss_fft_cpx *s, size_t begin, size_t end,
+                      size_t begReal, size_t endReal,
+                      size_t begImag, size_t endImag) {
+    float *f = (float *) s;
+    const __m256i beg = _mm256_setr_epi32(begReal, begImag, begReal, begImag,
+                                          begReal, begImag, begReal, begImag);
+    const __m256i stop = _mm256_setr_epi32(endReal, endImag, endReal, endImag,
+                                           endReal, endImag, endReal, endImag);
+    const __m256i step = _mm256_set1_epi32(4);
+    __m256i bins = _mm256_setr_epi32(begin, begin, begin + 1, begin + 1,
+                                     begin + 2, begin + 2, 
+                                     begin + 3, begin + 3);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        // bins >= beg && bins < stop
+        __m256i inside = _mm256_andnot_si256(_mm256_cmpgt_epi32(beg, bins),
+                                             _mm256_cmpgt_epi32(stop, bins));
+        __m256 value = _mm256_loadu_ps(&f[2 * i]);
+        _mm256_storeu_ps(&f[2 * i],
+                         _mm256_andnot_ps(_mm256_castsi256_ps(inside), value));
+        bins = _mm256_add_epi32(bins, step);
+    }
+    maskSpectrumScalar(s, i, end, begReal, endReal, begImag, endImag);
+}
+
+#endif /* SPECTRUM_X86 */
@@ -0,0 +1,22 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include "../RTES.h"
+#include "../kissfft/kiss_fft.h"
+
+// Kernels for the cancellation step on a spectrum of interleaved 
+// kiss_fft_cpx values. On x86 with a float kiss_fft_scalar these use AVX2
+// or SSE2, chosen at runtime, with a scalar fallback for other targets.
+
+// Finds the bins with the highest absolute real part and the highest
+// absolute imaginary part in one pass. Like a scalar scan with '>' the
+// first of equal values is returned.
+void findSpectrumPeaks(const kiss_fft_cpx *s, size_t size,
+                       size_t *peakReal, size_t *peakImag);
+
+// Sets the real parts of the bins [begReal, endReal) and the imaginary 
+// parts of the bins [begImag, endImag) to zero.
+void maskSpectrum(kiss_fft_cpx *s, size_t begReal, size_t endReal,
+                  size_t begImag, size_t endImag);
+
+#endif /* SPECTRUM_H */
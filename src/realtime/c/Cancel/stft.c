@@ -0,0 +1,60 @@
+#include "stft.h"
+#include "fftplan.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void createSTFT(stft_t *stft, size_t frameSize, size_t hopSize) {
+    if (hopSize == 0 || frameSize % hopSize != 0 || 
+        frameSize < 2 * hopSize) {
+        printf("Error in 'createSTFT': frameSize %zu has to be a multiple"
+               " of at least two times hopSize %zu.\n", frameSize, hopSize);
+        exit(EXIT_FAILURE);
+    }
+
+    stft->frameSize = frameSize;
+    stft->hopSize = hopSize;
+    stft->analysisWindow = malloc(frameSize * sizeof(kiss_fft_scalar));
+    stft->synthesisWindow = malloc(frameSize * sizeof(kiss_fft_scalar));
+    stft->history = malloc(frameSize * sizeof(kiss_fft_scalar));
+    stft->overlap = malloc(frameSize * sizeof(kiss_fft_scalar));
+    stft->hopSamples = malloc(hopSize * sizeof(sample_t));
+    if (stft->analysisWindow == NULL || stft->synthesisWindow == NULL ||
+        stft->history == NULL || stft->overlap == NULL ||
+        stft->hopSamples == NULL) {
+        printf("Error in 'createSTFT': malloc failed to allocate a frame"
+               " of %zu samples.\n", frameSize);
+        exit(EXIT_FAILURE);
+    }
+
+    // The squared window is a periodic Hann window, which sums to
+    // frameSize / (2 * hopSize) for every sample
+    double overlapGain = (double) frameSize / (2 * hopSize);
+    for (size_t i = 0; i < frameSize; i++) {
+        double window = sin(M_PI * i / frameSize);
+        stft->analysisWindow[i] = fractionToScalar(window);
+        stft->synthesisWindow[i] = fractionToScalar(window / overlapGain);
+    }
+
+    resetSTFT(stft);
+}
+
+// Prepares the state for a new noise
+void resetSTFT(stft_t *stft) {
+    memset(stft->history, 0, stft->frameSize * sizeof(kiss_fft_scalar));
+    memset(stft->overlap, 0, stft->frameSize * sizeof(kiss_fft_scalar));
+    stft->samplesIn = 0;
+    stft->samplesOut = 0;
+    stft->hopsToDiscard = stft->frameSize / stft->hopSize - 1;
+}
+
+void freeSTFT(stft_t *stft) {
+    // free(NULL) is allowed, so an unused stft_t can be freed as well
+    free(stft->analysisWindow);
+    free(stft->synthesisWindow);
+    free(stft->history);
+    free(stft->overlap);
+    free(stft->hopSamples);
+    *stft = (stft_t) { 0 };
+}
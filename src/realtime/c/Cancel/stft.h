@@ -0,0 +1,39 @@
+#ifndef STFT_H
+#define STFT_H
+
+#include "../RTES.h"
+#include "../kissfft/kiss_fft.h"
+
+// State of a streaming short-time fourier transform with weighted
+// overlap-add. Every hopSize new samples a frame of the last frameSize
+// samples is windowed, processed and windowed again before it is added to
+// the output. With a periodic sqrt-Hann window on both sides the overlapping
+// frames add up to a constant if frameSize is a multiple of hopSize and at
+// least twice as large.
+typedef struct {
+    size_t frameSize;
+    size_t hopSize;
+    // frameSize values of the sqrt-Hann window, the synthesis window is
+    // already multiplied by the overlap-add normalisation
+    kiss_fft_scalar *analysisWindow;
+    kiss_fft_scalar *synthesisWindow;
+    // The last frameSize input samples, the oldest first
+    kiss_fft_scalar *history;
+    // Overlap-added output of the frames, the oldest first. The first 
+    // hopSize values are complete and are output next.
+    kiss_fft_scalar *overlap;
+    // Work buffer of hopSize samples for the input and output of a hop
+    sample_t *hopSamples;
+    // Samples of the current noise that were received and output
+    size_t samplesIn;
+    size_t samplesOut;
+    // Complete hops that still have to be discarded, the first frames of 
+    // a noise output the zeros that were in the history before it began
+    size_t hopsToDiscard;
+} stft_t;
+
+void createSTFT(stft_t *stft, size_t frameSize, size_t hopSize);
+void resetSTFT(stft_t *stft);
+void freeSTFT(stft_t *stft);
+
+#endif /* STFT_H */
@@ -1,14 +1,12 @@
 #include "input.h"
 
-sample_t takeSample(void);
+sample_t takeSample(inputSettings_t *settings);
 
 void vTaskInput(void *pvParameters) {
     inputSettings_t *settings = (inputSettings_t*) pvParameters;
 
-    TickType_t xTimeTaskStarted;
+    TickType_t xTimeTaskStarted = xTaskGetTickCount();
     for (;;) {
-        xTimeTaskStarted = xTaskGetTickCount();
-
         doInput(settings);
 
         vTaskDelayUntil(&xTimeTaskStarted, settings->base.xTaskPeriod);
@@ -16,14 +14,20 @@ void vTaskInput(void *pvParameters) {
 }
 
 void doInput(inputSettings_t *settings) {
-    insertIntoBuffer(settings->outBuffer, takeSample());
+    insertIntoBuffer(settings->outBuffer, takeSample(settings));
 }
 
-sample_t takeSample(void) {
-    static size_t index = 0;
+sample_t takeSample(inputSettings_t *settings) {
+    size_t *index = &settings->sampleIndex;
 
-	if (index % 1000 == 0) printf("%zu\n", index);
-	if (index % numberOfSamples == 0) index = 0;
+	if (settings->printProgress && *index % 1000 == 0) {
+        printf("%zu\n", *index);
+    }
+    if (settings->wav != NULL) {
+        if (*index % settings->wav->numberOfSamples == 0) *index = 0;
+        return readWavSample(settings->wav, (*index)++);
+    }
+	if (*index % numberOfSamples == 0) *index = 0;
 
-    return readData(index++);
+    return readData((*index)++);
 }
@@ -4,10 +4,23 @@
 #include "../RTES.h"
 #include "../data.h"
 #include <stddef.h>
+#include <stdbool.h>
+
+#include "wavreader.h"
+#ifndef USE_TEMPFREERTOS
+// The windows version only compiles if both .h and .c are included
+#include "wavreader.c"
+#endif /* USE_TEMPFREERTOS */
 
 typedef struct {
     baseSettings_t base;
     buffer_t *outBuffer;
+    // Index of the next sample to take, 0 before the first call
+    size_t sampleIndex;
+    // Print the index of every 1000th sample
+    bool printProgress;
+    // Samples are read from this WAV file, from data.h when NULL
+    wavReader_t *wav;
 } inputSettings_t;
 
 void vTaskInput(void *pvParameters);
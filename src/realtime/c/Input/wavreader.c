@@ -0,0 +1,210 @@
+#include "wavreader.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define WAVE_FORMAT_PCM 0x0001
+#define WAVE_FORMAT_EXTENSIBLE 0xFFFE
+
+void readWavHeader(wavReader_t *reader, const char *path);
+void mapWavWindow(wavReader_t *reader, size_t offset);
+uint16_t readLittleEndian16(const uint8_t *bytes);
+uint32_t readLittleEndian32(const uint8_t *bytes);
+
+// Opens a PCM WAV file with 8, 16, 24 or 32 bit samples. Only the first
+// channel is used.
+void openWavReader(wavReader_t *reader, const char *path) {
+    memset(reader, 0, sizeof(wavReader_t));
+
+    reader->fd = open(path, O_RDONLY);
+    struct stat status;
+    if (reader->fd == -1 || fstat(reader->fd, &status) == -1) {
+        printf("Error in 'openWavReader': could not open %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    reader->fileSize = (size_t) status.st_size;
+
+    readWavHeader(reader, path);
+
+    // The samples are read front to back
+    posix_fadvise(reader->fd, (off_t) reader->dataOffset, 0,
+                  POSIX_FADV_SEQUENTIAL);
+    mapWavWindow(reader, reader->dataOffset);
+}
+
+// Validates the RIFF header and finds the "fmt " and "data" chunks, other
+// chunks (LIST, fact, ...) are skipped.
+void readWavHeader(wavReader_t *reader, const char *path) {
+    uint8_t header[12];
+    if (pread(reader->fd, header, 12, 0) != 12 ||
+        memcmp(header, "RIFF", 4) != 0 ||
+        memcmp(&header[8], "WAVE", 4) != 0) {
+        printf("Error in 'readWavHeader': %s is not a RIFF WAVE file.\n",
+               path);
+        exit(EXIT_FAILURE);
+    }
+
+    bool foundFormat = false;
+    size_t offset = 12;
+    for (;;) {
+        uint8_t chunk[8];
+        if (pread(reader->fd, chunk, 8, (off_t) offset) != 8) {
+            printf("Error in 'readWavHeader': %s has no data chunk.\n",
+                   path);
+            exit(EXIT_FAILURE);
+        }
+        size_t chunkSize = readLittleEndian32(&chunk[4]);
+        offset += 8;
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t format[24];
+            size_t formatSize = chunkSize < 24 ? chunkSize : 24;
+            if (chunkSize < 16 || pread(reader->fd, format, formatSize,
+                                   (off_t) offset) != (ssize_t) formatSize) {
+                printf("Error in 'readWavHeader': %s has an invalid fmt"
+                       " chunk.\n", path);
+                exit(EXIT_FAILURE);
+            }
+            uint16_t audioFormat = readLittleEndian16(&format[0]);
+            reader->channels = readLittleEndian16(&format[2]);
+            reader->sampleRate = readLittleEndian32(&format[4]);
+            reader->blockAlign = readLittleEndian16(&format[12]);
+            reader->bitsPerSample = readLittleEndian16(&format[14]);
+            // The extensible format keeps the real format in the first two
+            // bytes of its SubFormat GUID
+            if (audioFormat == WAVE_FORMAT_EXTENSIBLE && chunkSize >= 40) {
+                uint8_t subFormat[2];
+                if (pread(reader->fd, subFormat, 2,
+                          (off_t) offset + 24) == 2) {
+                    audioFormat = readLittleEndian16(subFormat);
+                }
+            }
+
+            const uint16_t bits = reader->bitsPerSample;
+            if (audioFormat != WAVE_FORMAT_PCM || reader->channels == 0 ||
+                (bits != 8 && bits != 16 && bits != 24 && bits != 32) ||
+                reader->blockAlign != reader->channels * bits / 8) {
+                printf("Error in 'readWavHeader': %s is not integer PCM with"
+                       " 8, 16, 24 or 32 bit samples.\n", path);
+                exit(EXIT_FAILURE);
+            }
+            foundFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!foundFormat) {
+                printf("Error in 'readWavHeader': %s has no fmt chunk before"
+                       " its data chunk.\n", path);
+                exit(EXIT_FAILURE);
+            }
+            // Recorders that were stopped before they could patch the
+            // header leave a wrong size, the file size limits it
+            size_t dataSize = chunkSize;
+            if (offset + dataSize > reader->fileSize) {
+                dataSize = reader->fileSize - offset;
+            }
+            reader->dataOffset = offset;
+            reader->numberOfSamples = dataSize / reader->blockAlign;
+            if (reader->numberOfSamples == 0) {
+                printf("Error in 'readWavHeader': %s contains no samples.\n",
+                       path);
+                exit(EXIT_FAILURE);
+            }
+            return;
+        }
+        // Chunks are padded to an even size
+        offset += chunkSize + (chunkSize & 1);
+    }
+}
+
+// Maps the window of the file that contains offset, the kernel is asked to
+// read the window after it in the background.
+void mapWavWindow(wavReader_t *reader, size_t offset) {
+    const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+
+    if (reader->window != NULL) {
+        munmap((void *) reader->window, reader->windowLength);
+    }
+    reader->windowOffset = offset - offset % pageSize;
+    reader->windowLength = reader->fileSize - reader->windowOffset;
+    if (reader->windowLength > WAV_WINDOW_SIZE) {
+        reader->windowLength = WAV_WINDOW_SIZE;
+    }
+
+    reader->window = mmap(NULL, reader->windowLength, PROT_READ, MAP_PRIVATE,
+                          reader->fd, (off_t) reader->windowOffset);
+    if (reader->window == MAP_FAILED) {
+        printf("Error in 'mapWavWindow': mmap failed to map %zu bytes at"
+               " offset %zu.\n", reader->windowLength, reader->windowOffset);
+        exit(EXIT_FAILURE);
+    }
+    madvise((void *) reader->window, reader->windowLength, MADV_SEQUENTIAL);
+    posix_fadvise(reader->fd,
+                  (off_t) (reader->windowOffset + reader->windowLength),
+                  WAV_WINDOW_SIZE, POSIX_FADV_WILLNEED);
+}
+
+// Returns the sample of the first channel at index, like readData() the
+// file is repeated after its last sample. Samples of every width are
+// scaled to 16 bit, the scale of the data.h recordings the tasks expect.
+sample_t readWavSample(wavReader_t *reader, size_t index) {
+    const size_t bytesPerSample = reader->bitsPerSample / 8;
+    size_t offset = reader->dataOffset +
+                    (index % reader->numberOfSamples) * reader->blockAlign;
+
+    if (offset < reader->windowOffset || offset + bytesPerSample >
+                              reader->windowOffset + reader->windowLength) {
+        mapWavWindow(reader, offset);
+    }
+    const uint8_t *bytes = &reader->window[offset - reader->windowOffset];
+
+    switch (bytesPerSample) {
+    case 1: // 8 bit samples are unsigned
+        return ((sample_t) bytes[0] - 128) * 256;
+    case 2:
+        return (int16_t) readLittleEndian16(bytes);
+    case 3: // Sign extend the top 16 bits of the 24 bit value
+        return (int32_t) ((uint32_t) bytes[1] << 16 |
+                          (uint32_t) bytes[2] << 24) >> 16;
+    default:
+        return (int32_t) readLittleEndian32(bytes) >> 16;
+    }
+}
+
+void closeWavReader(wavReader_t *reader) {
+    if (reader->window != NULL) {
+        munmap((void *) reader->window, reader->windowLength);
+    }
+    close(reader->fd);
+    memset(reader, 0, sizeof(wavReader_t));
+}
+
+uint16_t readLittleEndian16(const uint8_t *bytes) {
+    return (uint16_t) (bytes[0] | bytes[1] << 8);
+}
+
+uint32_t readLittleEndian32(const uint8_t *bytes) {
+    return (uint32_t) bytes[0] | (uint32_t) bytes[1] << 8 |
+           (uint32_t) bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+#else
+void openWavReader(wavReader_t *reader, const char *path) {
+    printf("Error in 'openWavReader': reading %s needs mmap, which is only"
+           " supported on Linux.\n", path);
+    exit(EXIT_FAILURE);
+}
+
+sample_t readWavSample(wavReader_t *reader, size_t index) {
+    return 0;
+}
+
+void closeWavReader(wavReader_t *reader) {
+    return;
+}
+#endif /* __linux__ */
@@ -0,0 +1,35 @@
+#ifndef WAVREADER_H
+#define WAVREADER_H
+
+#include "../data.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// The file is mapped in windows of this many bytes, so files larger than
+// the memory can be read. The next window is read ahead by the kernel
+// while the current one is used.
+#define WAV_WINDOW_SIZE (16 * 1024 * 1024)
+
+typedef struct {
+    int fd;
+    size_t fileSize;
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint16_t bitsPerSample;
+    // Bytes of one sample of every channel
+    uint16_t blockAlign;
+    // Offset of the first sample in the file
+    size_t dataOffset;
+    // Amount of samples per channel
+    size_t numberOfSamples;
+    // Currently mapped part of the file, starting at windowOffset
+    const uint8_t *window;
+    size_t windowOffset;
+    size_t windowLength;
+} wavReader_t;
+
+void openWavReader(wavReader_t *reader, const char *path);
+sample_t readWavSample(wavReader_t *reader, size_t index);
+void closeWavReader(wavReader_t *reader);
+
+#endif /* WAVREADER_H */
@@ -0,0 +1,151 @@
+#include "asyncwriter.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+void *runAsyncWriter(void *argument);
+double secondsBetween(struct timespec *start, struct timespec *end);
+
+void startAsyncWriter(asyncWriter_t *writer, FILE *fp, size_t blockSize) {
+    memset(writer, 0, sizeof(asyncWriter_t));
+    writer->fp = fp;
+    writer->blockSize = blockSize;
+    writer->nextOffset = ftello(fp);
+    if (writer->nextOffset < 0) {
+        printf("Error in 'startAsyncWriter': could not get the position in"
+               " the file.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < ASYNC_WRITER_BLOCKS; i++) {
+        writer->blocks[i] = malloc(blockSize);
+        if (writer->blocks[i] == NULL) {
+            printf("Error in 'startAsyncWriter': malloc failed for a block"
+                   " of %zu bytes.\n", blockSize);
+            exit(EXIT_FAILURE);
+        }
+    }
+    atomic_init(&writer->submitted, 0);
+    atomic_init(&writer->written, 0);
+    atomic_init(&writer->stopping, false);
+
+    if (sem_init(&writer->pending, 0, 0) != 0 ||
+        pthread_create(&writer->thread, NULL, runAsyncWriter, writer) != 0) {
+        printf("Error in 'startAsyncWriter': could not start the writer"
+               " thread.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Copies length (at most blockSize) bytes into the next free block and
+// queues it. Never waits: when the writer thread still has every block
+// queued the bytes are dropped, counted as a stall and false is returned.
+// The next block is still written after the dropped bytes, so they are
+// zeros in the file and the bytes after them keep their offset.
+bool submitToAsyncWriter(asyncWriter_t *writer, const uint8_t *bytes,
+                                                size_t length) {
+    size_t submitted = atomic_load_explicit(&writer->submitted,
+                                            memory_order_relaxed);
+    size_t written = atomic_load_explicit(&writer->written,
+                                          memory_order_acquire);
+    size_t queued = submitted - written;
+    if (queued == ASYNC_WRITER_BLOCKS) {
+        writer->stalls++;
+        writer->droppedBytes += length;
+        writer->nextOffset += (off_t) length;
+        return false;
+    }
+    if (queued + 1 > writer->maxQueued) writer->maxQueued = queued + 1;
+
+    size_t index = submitted % ASYNC_WRITER_BLOCKS;
+    memcpy(writer->blocks[index], bytes, length);
+    writer->lengths[index] = length;
+    writer->offsets[index] = writer->nextOffset;
+    writer->nextOffset += (off_t) length;
+    atomic_store_explicit(&writer->submitted, submitted + 1,
+                          memory_order_release);
+    sem_post(&writer->pending);
+    return true;
+}
+
+// Writes the queued blocks, stops the writer thread and fsyncs the file.
+// The file is extended to the end of the last block, also when that one
+// was dropped. The file itself stays open.
+void stopAsyncWriter(asyncWriter_t *writer) {
+    atomic_store_explicit(&writer->stopping, true, memory_order_release);
+    sem_post(&writer->pending);
+    pthread_join(writer->thread, NULL);
+    sem_destroy(&writer->pending);
+
+    if (ftruncate(fileno(writer->fp), writer->nextOffset) != 0) {
+        printf("Error in 'stopAsyncWriter': could not extend the file to"
+               " %lld bytes.\n", (long long) writer->nextOffset);
+        exit(EXIT_FAILURE);
+    }
+    if (fflush(writer->fp) != 0 || fsync(fileno(writer->fp)) != 0) {
+        printf("Error in 'stopAsyncWriter': could not sync the file.\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < ASYNC_WRITER_BLOCKS; i++) {
+        free(writer->blocks[i]);
+        writer->blocks[i] = NULL;
+    }
+}
+
+void *runAsyncWriter(void *argument) {
+    asyncWriter_t *writer = (asyncWriter_t*) argument;
+
+    for (;;) {
+        // Every submitted block and the stop posts the semaphore once
+        while (sem_wait(&writer->pending) != 0 && errno == EINTR);
+
+        size_t written = atomic_load_explicit(&writer->written,
+                                              memory_order_relaxed);
+        size_t submitted = atomic_load_explicit(&writer->submitted,
+                                                memory_order_acquire);
+        if (written == submitted) {
+            if (atomic_load_explicit(&writer->stopping,
+                                     memory_order_acquire)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        size_t index = written % ASYNC_WRITER_BLOCKS;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (pwrite(fileno(writer->fp), writer->blocks[index],
+                   writer->lengths[index], writer->offsets[index]) !=
+            (ssize_t) writer->lengths[index]) {
+            printf("Error in 'runAsyncWriter': could not write %zu"
+                   " bytes.\n", writer->lengths[index]);
+            exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double seconds = secondsBetween(&start, &end);
+        writer->totalWriteSeconds += seconds;
+        if (seconds > writer->maxWriteSeconds) {
+            writer->maxWriteSeconds = seconds;
+        }
+        atomic_store_explicit(&writer->written, written + 1,
+                              memory_order_release);
+    }
+}
+
+double secondsBetween(struct timespec *start, struct timespec *end) {
+    return (double) (end->tv_sec - start->tv_sec) +
+           (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void printStatisticsAsyncWriter(asyncWriter_t *writer, const char *name) {
+    printf("%s: %zu blocks written, at most %zu/%d queued, %zu stalls"
+           " (%zu bytes dropped, left as zeros in the file), longest write"
+           " %.3f ms, total %.3f ms\n",
+           name, atomic_load(&writer->written), writer->maxQueued,
+           ASYNC_WRITER_BLOCKS, writer->stalls, writer->droppedBytes,
+           writer->maxWriteSeconds * 1e3, writer->totalWriteSeconds * 1e3);
+}
@@ -0,0 +1,58 @@
+#ifndef ASYNCWRITER_H
+#define ASYNCWRITER_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// Amount of preallocated blocks in the queue between the producer and the
+// writer thread
+#define ASYNC_WRITER_BLOCKS 8
+
+// Writes blocks of bytes to a file on a background thread, so the task
+// that produces them never waits for the filesystem. One producer thread
+// fills the blocks and hands them over through a lock-free queue, the
+// writer thread is woken with a semaphore. Every block is written at its
+// own offset in the file, so a block that is dropped leaves a hole of
+// zeros instead of moving the blocks after it.
+typedef struct {
+    FILE *fp;
+    size_t blockSize;
+    uint8_t *blocks[ASYNC_WRITER_BLOCKS];
+    size_t lengths[ASYNC_WRITER_BLOCKS];
+    off_t offsets[ASYNC_WRITER_BLOCKS];
+    // Offset of the next block that is submitted, only the producer uses
+    // this. Blocks start at the position of fp when the writer started.
+    off_t nextOffset;
+    // Total amount of blocks ever submitted, only the producer changes
+    // this (release), the next block to fill is submitted % BLOCKS
+    _Atomic size_t submitted;
+    // Total amount of blocks ever written, only the writer thread changes
+    // this (release)
+    _Atomic size_t written;
+    _Atomic bool stopping;
+    sem_t pending;
+    pthread_t thread;
+    // Statistics of the producer: the times all blocks were still queued
+    // (the writer stalled) and their bytes were dropped, which are zeros
+    // in the file, and the highest amount of queued blocks
+    size_t stalls;
+    size_t droppedBytes;
+    size_t maxQueued;
+    // Statistics of the writer thread, only read after stopAsyncWriter()
+    double maxWriteSeconds;
+    double totalWriteSeconds;
+} asyncWriter_t;
+
+void startAsyncWriter(asyncWriter_t *writer, FILE *fp, size_t blockSize);
+bool submitToAsyncWriter(asyncWriter_t *writer, const uint8_t *bytes,
+                                                size_t length);
+void stopAsyncWriter(asyncWriter_t *writer);
+void printStatisticsAsyncWriter(asyncWriter_t *writer, const char *name);
+
+#endif /* ASYNCWRITER_H */
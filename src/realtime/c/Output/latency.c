@@ -0,0 +1,100 @@
+#include "latency.h"
+
+void summariseLatencyEvent(latencyReport_t *report, latencyEvent_t *event);
+int compareLatencies(const void *a, const void *b);
+
+// Allocates room for the latencies of maxSamples samples (at most
+// LATENCY_MAX_SAMPLES), e.g. the amount of samples of the input
+void createLatencyReport(latencyReport_t *report, uint32_t sampleRate,
+                         size_t maxSamples) {
+    memset(report, 0, sizeof(latencyReport_t));
+    report->sampleRate = sampleRate;
+    report->maxEvents = LATENCY_MAX_EVENTS;
+    report->maxLatencies = maxSamples < LATENCY_MAX_SAMPLES ?
+                           maxSamples : LATENCY_MAX_SAMPLES;
+    report->events = malloc(report->maxEvents * sizeof(latencyEvent_t));
+    report->latencies = malloc(report->maxLatencies * sizeof(uint32_t));
+    if (report->events == NULL || report->latencies == NULL) {
+        printf("Error in 'createLatencyReport': malloc failed to allocate"
+               " %zu latencies.\n", report->maxLatencies);
+        exit(EXIT_FAILURE);
+    }
+    // Touch every page now, so adding a sample never page faults
+    memset(report->latencies, 0, report->maxLatencies * sizeof(uint32_t));
+}
+
+// Adds the sample the Output Task outputs at tick outputIndex. The Input
+// Task took the sample at tick inputIndex, so the latency is the
+// difference between them.
+void addToLatencyReport(latencyReport_t *report, sampleTag_t tag,
+                        size_t outputIndex) {
+    if (tag.event == 0) return;
+    if (report->numberOfLatencies == report->maxLatencies) {
+        report->droppedSamples++;
+        return;
+    }
+
+    latencyEvent_t *event = report->numberOfEvents == 0 ? NULL :
+                            &report->events[report->numberOfEvents - 1];
+    if (event == NULL || event->event != tag.event) {
+        if (report->numberOfEvents == report->maxEvents) {
+            report->droppedSamples++;
+            return;
+        }
+        event = &report->events[report->numberOfEvents++];
+        memset(event, 0, sizeof(latencyEvent_t));
+        event->event = tag.event;
+        event->firstInputIndex = tag.inputIndex;
+        event->firstLatency = report->numberOfLatencies;
+    }
+
+    report->latencies[report->numberOfLatencies++] = (uint32_t) 
+                (outputIndex > tag.inputIndex ? 
+                 outputIndex - tag.inputIndex : 0);
+    event->samples++;
+}
+
+void printLatencyReport(latencyReport_t *report) {
+    const double msPerSample = 1000.0 / report->sampleRate;
+
+    printf("latency (ms):   event    input  samples      min   median"
+           "      p99      max\n");
+    for (size_t i = 0; i < report->numberOfEvents; i++) {
+        latencyEvent_t *event = &report->events[i];
+        summariseLatencyEvent(report, event);
+        printf("latency (ms): %7zu %8.1f %8zu %8.1f %8.1f %8.1f %8.1f\n",
+               event->event, event->firstInputIndex * msPerSample,
+               event->samples, event->minLatency * msPerSample,
+               event->medianLatency * msPerSample,
+               event->p99Latency * msPerSample,
+               event->maxLatency * msPerSample);
+    }
+    if (report->droppedSamples != 0) {
+        printf("latency: %zu samples did not fit in the report\n",
+               report->droppedSamples);
+    }
+}
+
+void freeLatencyReport(latencyReport_t *report) {
+    free(report->events);
+    free(report->latencies);
+    report->events = NULL;
+    report->latencies = NULL;
+}
+
+// Sorts the latencies of the event to find its percentiles
+void summariseLatencyEvent(latencyReport_t *report, latencyEvent_t *event) {
+    uint32_t *latencies = &report->latencies[event->firstLatency];
+    const size_t n = event->samples;
+    qsort(latencies, n, sizeof(uint32_t), compareLatencies);
+    event->minLatency = latencies[0];
+    event->medianLatency = latencies[(n - 1) / 2];
+    event->p99Latency = latencies[(n - 1) * 99 / 100];
+    event->maxLatency = latencies[n - 1];
+}
+
+int compareLatencies(const void *a, const void *b) {
+    const uint32_t x = *(const uint32_t*) a;
+    const uint32_t y = *(const uint32_t*) b;
+    return (x > y) - (x < y);
+}
@@ -0,0 +1,54 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "../RTES.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// Most samples a report can hold, 6 minutes of 44.1 kHz, the samples of
+// cancelling noise after it are only counted
+#define LATENCY_MAX_SAMPLES (16 * 1024 * 1024)
+// Most noises a report can hold
+#define LATENCY_MAX_EVENTS 4096
+
+// Latency between a sample of a noise entering the inputToRecognize buffer
+// and the matching sample of cancelling noise leaving the Output Task, in
+// samples. Every sample the Output Task outputs is added with its tag, see
+// traceBuffer(). The samples without an event (silence) are not counted.
+typedef struct {
+    size_t event;
+    size_t firstInputIndex; // Input index of the first sample output
+    size_t samples; // Amount of samples output
+    size_t firstLatency; // Index of its first sample in the latencies
+    // Summary, computed by printLatencyReport()
+    uint32_t minLatency;
+    uint32_t medianLatency;
+    uint32_t p99Latency;
+    uint32_t maxLatency;
+} latencyEvent_t;
+
+// Everything is allocated by createLatencyReport(), so adding a sample
+// never allocates or sorts. The latencies are only summarised when the
+// report is printed.
+typedef struct {
+    uint32_t sampleRate;
+    latencyEvent_t *events;
+    size_t numberOfEvents;
+    size_t maxEvents;
+    // The latencies of the samples in the order they were output, the
+    // samples of an event are consecutive
+    uint32_t *latencies;
+    size_t numberOfLatencies;
+    size_t maxLatencies;
+    // Samples that didn't fit in the report
+    size_t droppedSamples;
+} latencyReport_t;
+
+void createLatencyReport(latencyReport_t *report, uint32_t sampleRate,
+                         size_t maxSamples);
+void addToLatencyReport(latencyReport_t *report, sampleTag_t tag,
+                        size_t outputIndex);
+void printLatencyReport(latencyReport_t *report);
+void freeLatencyReport(latencyReport_t *report);
+
+#endif /* LATENCY_H */
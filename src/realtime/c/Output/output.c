@@ -2,14 +2,13 @@
 
 sample_t readSample(buffer_t *buffer);
 void outputSample(sample_t sample, FILE *fpOutput);
+size_t outputTick(outputSettings_t *settings);
 
 void vTaskOutput(void *pvParameters) {
     outputSettings_t *settings = (outputSettings_t*) pvParameters;
 
-    TickType_t xTimeTaskStarted;
+    TickType_t xTimeTaskStarted = xTaskGetTickCount();
     for (;;) {
-        xTimeTaskStarted = xTaskGetTickCount();
-
         doOutput(settings);
 
         vTaskDelayUntil(&xTimeTaskStarted, settings->base.xTaskPeriod);
@@ -17,11 +16,34 @@ void vTaskOutput(void *pvParameters) {
 }
 
 void doOutput(outputSettings_t *settings) {
-    outputSample(readSample(settings->inBuffer), settings->fpOutput);
+    if (settings->latency != NULL && usedInBuffer(settings->inBuffer) > 0) {
+        addToLatencyReport(settings->latency, 
+                           tagOfBuffer(settings->inBuffer, 0),
+                           outputTick(settings));
+    }
+    settings->samplesOutput++;
+
+    sample_t sample = readSample(settings->inBuffer);
+    if (settings->wav != NULL) {
+        writeWavSample(settings->wav, sample);
+    } else {
+        outputSample(sample, settings->fpOutput);
+    }
+}
+
+// Tick at which the sample leaves now. The host scheduler may release
+// the task late, the simulators release it exactly once every tick.
+size_t outputTick(outputSettings_t *settings) {
+#ifdef USE_HOST_SCHEDULER
+    (void) settings;
+    return (size_t) xTaskGetTickCount();
+#else
+    return settings->samplesOutput;
+#endif /* USE_HOST_SCHEDULER */
 }
 
 sample_t readSample(buffer_t *buffer) {
-    if (buffer->used == 0) {
+    if (usedInBuffer(buffer) == 0) {
         return 0;
     } else {
         sample_t sample = readFromBuffer(buffer, 0);
@@ -6,10 +6,29 @@
 #include <stddef.h>
 #include <stdio.h>
 
+#include "wavwriter.h"
+#ifndef USE_TEMPFREERTOS
+// The windows version only compiles if both .h and .c are included
+#include "wavwriter.c"
+#endif /* USE_TEMPFREERTOS */
+
+#include "latency.h"
+#ifndef USE_TEMPFREERTOS
+#include "latency.c"
+#endif /* USE_TEMPFREERTOS */
+
 typedef struct {
     baseSettings_t base;
     buffer_t *inBuffer;
+    // Samples are written as CSV to fpOutput, or to wav when it is not NULL
     FILE *fpOutput;
+    wavWriter_t *wav;
+    // When not NULL the latency of every sample of cancelling noise is
+    // added to it, the inBuffer has to be traced, see traceBuffer()
+    latencyReport_t *latency;
+    // Amount of samples output, one every period, the tick of the next
+    // sample when the tasks are simulated
+    size_t samplesOutput;
 } outputSettings_t;
 
 void vTaskOutput(void *pvParameters);
@@ -0,0 +1,146 @@
+#include "wavwriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WAV_HEADER_SIZE 44
+
+void writeWavHeader(wavWriter_t *writer);
+void flushWavBlock(wavWriter_t *writer);
+void putLittleEndian16(uint8_t *bytes, uint16_t value);
+void putLittleEndian32(uint8_t *bytes, uint32_t value);
+
+// Creates a mono PCM WAV file with 16 or 32 bit samples. The sizes in the
+// header are only correct after closeWavWriter(). An async writer leaves
+// the file I/O to a background thread, which is synced on close.
+void openWavWriter(wavWriter_t *writer, const char *path,
+                   uint32_t sampleRate, uint16_t bitsPerSample, bool async) {
+    if (bitsPerSample != 16 && bitsPerSample != 32) {
+        printf("Error in 'openWavWriter': %u bit samples are not"
+               " supported, use 16 or 32.\n", bitsPerSample);
+        exit(EXIT_FAILURE);
+    }
+
+    writer->fp = fopen(path, "wb");
+    if (writer->fp == NULL) {
+        printf("Error in 'openWavWriter': could not create %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    // The blocks are already large, stdio buffering would only copy them
+    setvbuf(writer->fp, NULL, _IONBF, 0);
+
+    writer->sampleRate = sampleRate;
+    writer->bitsPerSample = bitsPerSample;
+    writer->numberOfSamples = 0;
+    writer->usedInBlock = 0;
+    writer->async = async;
+
+    writeWavHeader(writer);
+    if (async) {
+        startAsyncWriter(&writer->asyncWriter, writer->fp,
+                         WAV_WRITE_BLOCK_SIZE);
+    }
+}
+
+void writeWavSample(wavWriter_t *writer, sample_t sample) {
+    if (writer->usedInBlock == WAV_WRITE_BLOCK_SIZE) flushWavBlock(writer);
+
+    uint8_t *bytes = &writer->block[writer->usedInBlock];
+    if (writer->bitsPerSample == 16) {
+        if (sample > INT16_MAX) sample = INT16_MAX;
+        if (sample < INT16_MIN) sample = INT16_MIN;
+        putLittleEndian16(bytes, (uint16_t) sample);
+        writer->usedInBlock += 2;
+    } else {
+        putLittleEndian32(bytes, (uint32_t) sample);
+        writer->usedInBlock += 4;
+    }
+    writer->numberOfSamples++;
+}
+
+// Writes the rest of the samples and patches the RIFF and data sizes in
+// the header now the amount of samples is known
+void closeWavWriter(wavWriter_t *writer) {
+    flushWavBlock(writer);
+    if (writer->async) stopAsyncWriter(&writer->asyncWriter);
+
+    if (fseek(writer->fp, 0, SEEK_SET) != 0) {
+        printf("Error in 'closeWavWriter': could not seek to the header.\n");
+        exit(EXIT_FAILURE);
+    }
+    writeWavHeader(writer);
+    if (writer->async && fsync(fileno(writer->fp)) != 0) {
+        printf("Error in 'closeWavWriter': could not sync the header.\n");
+        exit(EXIT_FAILURE);
+    }
+    fclose(writer->fp);
+    writer->fp = NULL;
+}
+
+void writeWavHeader(wavWriter_t *writer) {
+    const uint16_t bytesPerSample = writer->bitsPerSample / 8;
+    const uint32_t dataSize = (uint32_t) (writer->numberOfSamples *
+                                          bytesPerSample);
+    uint8_t header[WAV_HEADER_SIZE];
+
+    memcpy(&header[0], "RIFF", 4);
+    putLittleEndian32(&header[4], WAV_HEADER_SIZE - 8 + dataSize);
+    memcpy(&header[8], "WAVE", 4);
+    memcpy(&header[12], "fmt ", 4);
+    putLittleEndian32(&header[16], 16);
+    putLittleEndian16(&header[20], 1); // PCM
+    putLittleEndian16(&header[22], 1); // Mono
+    putLittleEndian32(&header[24], writer->sampleRate);
+    putLittleEndian32(&header[28], writer->sampleRate * bytesPerSample);
+    putLittleEndian16(&header[32], bytesPerSample);
+    putLittleEndian16(&header[34], writer->bitsPerSample);
+    memcpy(&header[36], "data", 4);
+    putLittleEndian32(&header[40], dataSize);
+
+    if (fwrite(header, 1, WAV_HEADER_SIZE, writer->fp) != WAV_HEADER_SIZE) {
+        printf("Error in 'writeWavHeader': could not write the header.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void flushWavBlock(wavWriter_t *writer) {
+    if (writer->usedInBlock == 0) return;
+
+    if (writer->async) {
+        // A stalled writer thread drops the block, its samples are silence
+        // in the file so the samples after it keep their time
+        submitToAsyncWriter(&writer->asyncWriter, writer->block,
+                            writer->usedInBlock);
+        writer->usedInBlock = 0;
+        return;
+    }
+
+    if (fwrite(writer->block, 1, writer->usedInBlock, writer->fp) !=
+                                                    writer->usedInBlock) {
+        printf("Error in 'flushWavBlock': could not write %zu bytes.\n",
+               writer->usedInBlock);
+        exit(EXIT_FAILURE);
+    }
+    writer->usedInBlock = 0;
+}
+
+void printStatisticsWavWriter(wavWriter_t *writer) {
+    if (writer->async) {
+        printStatisticsAsyncWriter(&writer->asyncWriter, "wavWriter");
+    } else {
+        printf("wavWriter: %zu samples written\n", writer->numberOfSamples);
+    }
+}
+
+void putLittleEndian16(uint8_t *bytes, uint16_t value) {
+    bytes[0] = (uint8_t) value;
+    bytes[1] = (uint8_t) (value >> 8);
+}
+
+void putLittleEndian32(uint8_t *bytes, uint32_t value) {
+    bytes[0] = (uint8_t) value;
+    bytes[1] = (uint8_t) (value >> 8);
+    bytes[2] = (uint8_t) (value >> 16);
+    bytes[3] = (uint8_t) (value >> 24);
+}
@@ -0,0 +1,42 @@
+#ifndef WAVWRITER_H
+#define WAVWRITER_H
+
+#include "../RTES.h"
+#include "../data.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "asyncwriter.h"
+#ifndef USE_TEMPFREERTOS
+// The windows version only compiles if both .h and .c are included
+#include "asyncwriter.c"
+#endif /* USE_TEMPFREERTOS */
+
+// Samples are collected in a block of this many bytes and written with a
+// single fwrite when it is full
+#define WAV_WRITE_BLOCK_SIZE (16 * 1024)
+
+typedef struct {
+    FILE *fp;
+    uint32_t sampleRate;
+    // 16 or 32, 16 bit samples are saturated to the int16_t range
+    uint16_t bitsPerSample;
+    // Amount of samples written, including the ones still in block
+    size_t numberOfSamples;
+    uint8_t block[WAV_WRITE_BLOCK_SIZE];
+    size_t usedInBlock;
+    // Full blocks are handed to asyncWriter instead of being written by
+    // the task itself
+    bool async;
+    asyncWriter_t asyncWriter;
+} wavWriter_t;
+
+void openWavWriter(wavWriter_t *writer, const char *path,
+                   uint32_t sampleRate, uint16_t bitsPerSample, bool async);
+void writeWavSample(wavWriter_t *writer, sample_t sample);
+void closeWavWriter(wavWriter_t *writer);
+void printStatisticsWavWriter(wavWriter_t *writer);
+
+#endif /* WAVWRITER_H */
@@ -1,7 +1,43 @@
+#ifdef __linux__
+// Needed for memfd_create()
+#define _GNU_SOURCE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif /* __linux__ */
+
+#ifdef USE_SPSC_BUFFER
+#include <time.h>
+#include <sched.h>
+#endif /* USE_SPSC_BUFFER */
+
 #include "RTES.h"
 
 // Increment the index by 'n', rollover if index+n exceeds max.
 void updateIndex(size_t *index, size_t n, size_t max);
+size_t readPosition(buffer_t *buffer);
+size_t writePosition(buffer_t *buffer);
+void advanceRead(buffer_t *buffer, size_t n);
+void advanceWrite(buffer_t *buffer, size_t n);
+void updateHighWaterMark(buffer_t *buffer);
+size_t makeRoom(buffer_t *buffer, size_t n);
+size_t waitForRoom(buffer_t *buffer, size_t n);
+bool droppedFirst(buffer_t *buffer);
+size_t splitRegion(buffer_t *buffer, size_t index, size_t n, 
+                                                   span_t spans[2]);
+void writeArrayToBuffer(buffer_t *dest, const sample_t src[], size_t n);
+void readArrayFromBuffer(sample_t dest[], buffer_t *src, size_t n,
+                                                         size_t offset);
+size_t readableOrSilence(sample_t dest[], buffer_t *src, size_t n,
+                                          size_t offset, size_t used);
+size_t pushedTags(sampleTags_t *tags);
+size_t poppedTags(sampleTags_t *tags);
+void setPushedTags(sampleTags_t *tags, size_t pushed);
+void setPoppedTags(sampleTags_t *tags, size_t popped);
+void pushTag(sampleTags_t *tags, size_t position, size_t inputIndex,
+                                                  size_t event);
+void popTags(sampleTags_t *tags);
+void skipTags(buffer_t *buffer, size_t n);
+void tagSkippedSamples(sampleTags_t *tags);
 
 buffer_t createBuffer(const char *name, size_t size) {
     sample_t *array = malloc(size * sizeof(sample_t));
@@ -22,13 +58,61 @@ buffer_t createBuffer(const char *name, size_t size) {
     buffer_t buffer = {
         .data = (sample_t *)array,
         .name = name,
-        .read = 0,
-        .write = 0,
-        .used = 0,
-        .size = size
+        // The indices, the amount of used samples and the statistics
+        // start at 0, the policy starts at BUFFER_POLICY_FAIL
+        .size = size,
+        .mirrored = false
+    };
+
+    return buffer;
+}
+
+// Creates a buffer of which the memory is mapped twice, back to back. Any
+// region of at most buffer->size samples starting inside the buffer is
+// then contiguous in memory, so the spans and views of this buffer never
+// wrap. The capacity is rounded up to a whole amount of pages. Falls back
+// to createBuffer() on platforms without memfd_create().
+buffer_t createMirroredBuffer(const char *name, size_t size) {
+#ifdef __linux__
+    const size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t bytes = size * sizeof(sample_t);
+    bytes = ((bytes + pageSize - 1) / pageSize) * pageSize;
+
+    int fd = memfd_create(name, MFD_CLOEXEC);
+    if (fd == -1 || ftruncate(fd, (off_t) bytes) == -1) {
+        printf("Error in 'createMirroredBuffer' (%s): unable to create a"
+               " memfd of %zu bytes.\n", name, bytes);
+        exit(EXIT_FAILURE);
+    }
+
+    // Reserve room for both mappings, then map the memfd over both halves
+    char *base = mmap(NULL, 2 * bytes, PROT_NONE, 
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED ||
+        mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+             fd, 0) == MAP_FAILED ||
+        mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, 
+             MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        printf("Error in 'createMirroredBuffer' (%s): mmap failed to map"
+               " 2 * %zu bytes of memory.\n", name, bytes);
+        exit(EXIT_FAILURE);
+    }
+    // The mappings keep the memory alive
+    close(fd);
+
+    buffer_t buffer = {
+        .data = (sample_t *)base,
+        .name = name,
+        // The indices, the amount of used samples and the statistics
+        // start at 0, the policy starts at BUFFER_POLICY_FAIL
+        .size = bytes / sizeof(sample_t),
+        .mirrored = true
     };
 
     return buffer;
+#else
+    return createBuffer(name, size);
+#endif /* __linux__ */
 }
 
 // Increment the index by 'n', rollover if index+n exceeds max.
@@ -36,74 +120,466 @@ void updateIndex(size_t *index, size_t n, size_t max) {
     *index = (*index + n) % max;
 }
 
+#ifndef USE_SPSC_BUFFER
+// Amount of sample_t values currently stored in the buffer.
+size_t usedInBuffer(buffer_t *buffer) {
+    return buffer->used;
+}
+
+// Index of buffer->data to read the first value from.
+size_t readPosition(buffer_t *buffer) {
+    return buffer->read;
+}
+
+// Index of buffer->data to write the next value to.
+size_t writePosition(buffer_t *buffer) {
+    return buffer->write;
+}
+
+// Marks the first 'n' samples as read, these can be overwritten now.
+void advanceRead(buffer_t *buffer, size_t n) {
+    updateIndex(&buffer->read, n, buffer->size);
+    buffer->used -= n;
+    if (buffer->tags != NULL) {
+        buffer->tags->read += n;
+        popTags(buffer->tags);
+    }
+}
+
+// Marks the next 'n' samples as written, these can be read now.
+void advanceWrite(buffer_t *buffer, size_t n) {
+    if (buffer->tags != NULL) tagSkippedSamples(buffer->tags);
+    updateIndex(&buffer->write, n, buffer->size);
+    buffer->used += n;
+    updateHighWaterMark(buffer);
+    if (buffer->tags != NULL) buffer->tags->written += n;
+}
+
+// The amounts of tags that have been added to and removed from the tags.
+size_t pushedTags(sampleTags_t *tags) {
+    return tags->pushed;
+}
+
+size_t poppedTags(sampleTags_t *tags) {
+    return tags->popped;
+}
+
+void setPushedTags(sampleTags_t *tags, size_t pushed) {
+    tags->pushed = pushed;
+}
+
+void setPoppedTags(sampleTags_t *tags, size_t popped) {
+    tags->popped = popped;
+}
+#else
+// Amount of sample_t values currently stored in the buffer. The result is
+// exact for the side that calls it: the own index can't change meanwhile,
+// the other side can only make the buffer less full (producer) or more
+// full (consumer) than reported.
+size_t usedInBuffer(buffer_t *buffer) {
+    size_t read = atomic_load_explicit(&buffer->read, memory_order_acquire);
+    size_t write = atomic_load_explicit(&buffer->write, 
+                                        memory_order_acquire);
+    return write - read;
+}
+
+// Index of buffer->data to read the first value from, consumer only.
+size_t readPosition(buffer_t *buffer) {
+    return atomic_load_explicit(&buffer->read, memory_order_relaxed) 
+           % buffer->size;
+}
+
+// Index of buffer->data to write the next value to, producer only.
+size_t writePosition(buffer_t *buffer) {
+    return atomic_load_explicit(&buffer->write, memory_order_relaxed) 
+           % buffer->size;
+}
+
+// Marks the first 'n' samples as read, consumer only. The release makes
+// sure the samples are read before the producer can overwrite them.
+void advanceRead(buffer_t *buffer, size_t n) {
+    size_t read = atomic_load_explicit(&buffer->read, memory_order_relaxed);
+    atomic_store_explicit(&buffer->read, read + n, memory_order_release);
+    if (buffer->tags != NULL) {
+        buffer->tags->read += n;
+        popTags(buffer->tags);
+    }
+}
+
+// Marks the next 'n' samples as written, producer only. The release makes
+// sure the samples are visible before the consumer can read them.
+void advanceWrite(buffer_t *buffer, size_t n) {
+    if (buffer->tags != NULL) tagSkippedSamples(buffer->tags);
+    size_t write = atomic_load_explicit(&buffer->write, 
+                                        memory_order_relaxed);
+    atomic_store_explicit(&buffer->write, write + n, memory_order_release);
+    updateHighWaterMark(buffer);
+    if (buffer->tags != NULL) buffer->tags->written += n;
+}
+
+// The amounts of tags, the tags are published with the release of pushed
+// like the samples are with the release of write.
+size_t pushedTags(sampleTags_t *tags) {
+    return atomic_load_explicit(&tags->pushed, memory_order_acquire);
+}
+
+size_t poppedTags(sampleTags_t *tags) {
+    return atomic_load_explicit(&tags->popped, memory_order_acquire);
+}
+
+void setPushedTags(sampleTags_t *tags, size_t pushed) {
+    atomic_store_explicit(&tags->pushed, pushed, memory_order_release);
+}
+
+void setPoppedTags(sampleTags_t *tags, size_t popped) {
+    atomic_store_explicit(&tags->popped, popped, memory_order_release);
+}
+#endif /* USE_SPSC_BUFFER */
+
+// Sets what the buffer does on an overrun or underrun, see bufferPolicy_t.
+// blockTimeoutUs is only used by BUFFER_POLICY_BLOCK.
+void setBufferPolicy(buffer_t *buffer, bufferPolicy_t policy,
+                                       unsigned long blockTimeoutUs) {
+    buffer->policy = policy;
+    buffer->blockTimeoutUs = blockTimeoutUs;
+}
+
+// Called by the producer after writing, keeps track of the fullest the
+// buffer has been to see how close the pipeline gets to an overrun.
+void updateHighWaterMark(buffer_t *buffer) {
+    const size_t used = usedInBuffer(buffer);
+    if (used > buffer->highWaterMark) buffer->highWaterMark = used;
+}
+
+// Applies the overrun policy of the buffer before 'n' samples are written,
+// returns for how many of them there is room. The caller handles the 
+// samples that don't fit (exit for BUFFER_POLICY_FAIL, otherwise they are
+// dropped and added to buffer->droppedSamples).
+size_t makeRoom(buffer_t *buffer, size_t n) {
+    size_t room = buffer->size - usedInBuffer(buffer);
+    if (room >= n) return n;
+
+    switch (buffer->policy) {
+    case BUFFER_POLICY_DROP_OLDEST:
+#ifndef USE_SPSC_BUFFER
+        {
+            size_t drop = n - room;
+            if (drop > usedInBuffer(buffer)) drop = usedInBuffer(buffer);
+            advanceRead(buffer, drop);
+            buffer->droppedSamples += drop;
+            room += drop;
+        }
+#endif /* USE_SPSC_BUFFER */
+        break;
+    case BUFFER_POLICY_BLOCK:
+        room = waitForRoom(buffer, n);
+        break;
+    default:
+        break;
+    }
+
+    return (room < n) ? room : n;
+}
+
+// Whether the oldest samples are dropped when a block of samples is larger
+// than the room makeRoom() could make, otherwise the newest are dropped.
+bool droppedFirst(buffer_t *buffer) {
+#ifndef USE_SPSC_BUFFER
+    return buffer->policy == BUFFER_POLICY_DROP_OLDEST;
+#else
+    return false;
+#endif /* USE_SPSC_BUFFER */
+}
+
+// Waits until the consumer made room for 'n' samples or until 
+// buffer->blockTimeoutUs passed, returns the room in the buffer. Without
+// USE_SPSC_BUFFER the consumer runs on the same thread, so waiting would
+// never help and this returns immediately.
+size_t waitForRoom(buffer_t *buffer, size_t n) {
+#ifdef USE_SPSC_BUFFER
+    struct timespec now, deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += buffer->blockTimeoutUs / 1000000;
+    deadline.tv_nsec += (buffer->blockTimeoutUs % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (buffer->size - usedInBuffer(buffer) < n) {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec
+                                    && now.tv_nsec >= deadline.tv_nsec)) {
+            break;
+        }
+        sched_yield();
+    }
+#endif /* USE_SPSC_BUFFER */
+    return buffer->size - usedInBuffer(buffer);
+}
+
 // Insert a sample into index buffer->write.
 void insertIntoBuffer(buffer_t *buffer, sample_t data) {
-    if (buffer->used == buffer->size) {
-        printf("Error in 'insertIntoBuffer' (%s): trying to insert into a"
-               " full buffer.\n", buffer->name);
-        exit(EXIT_FAILURE);
+    if (makeRoom(buffer, 1) == 0) {
+        if (buffer->policy == BUFFER_POLICY_FAIL) {
+            printf("Error in 'insertIntoBuffer' (%s): trying to insert into"
+                   " a full buffer.\n", buffer->name);
+            exit(EXIT_FAILURE);
+        }
+        buffer->droppedSamples++;
+        skipTags(buffer, 1);
+        return;
     }
 
-    buffer->data[buffer->write] = data;
-    buffer->used++;
-    updateIndex(&buffer->write, 1, buffer->size);
+    buffer->data[writePosition(buffer)] = data;
+    advanceWrite(buffer, 1);
 }
 
 // Read a sample from a index relative to buffer->read.
 sample_t readFromBuffer(buffer_t *buffer, size_t offset) {
-    if (buffer->used == 0) {
+    const size_t used = usedInBuffer(buffer);
+
+    if (offset >= used && buffer->policy != BUFFER_POLICY_FAIL) {
+        // Underrun, the missing sample is read as silence
+        buffer->underrunSamples++;
+        return 0;
+    }
+
+    if (used == 0) {
         printf("Error in 'readFromBuffer' (%s): trying to read from an" 
                " empty buffer.\n", buffer->name);
         exit(EXIT_FAILURE);
     } 
 
-    if (offset > buffer->used - 1) {
+    if (offset > used - 1) {
         printf("Error in 'readFromBuffer' (%s): trying to read from an"
                " invalid index.\n", buffer->name);
         exit(EXIT_FAILURE);
     }
 
-    size_t index = buffer->read;
+    size_t index = readPosition(buffer);
     updateIndex(&index, offset, buffer->size);
     return buffer->data[index];
 }
 
 // Remove 'n' samples from the buffer by moving the read index.
 void removeFromBuffer(buffer_t *buffer, size_t n) {
-    if (n > buffer->used) {
+    const size_t used = usedInBuffer(buffer);
+
+    if (n > used && buffer->policy != BUFFER_POLICY_FAIL) {
+        // Underrun, remove everything there is
+        buffer->underrunSamples += n - used;
+        n = used;
+    }
+
+    if (n > used) {
         printf("Error in 'removeFromBuffer' (%s): trying to remove %zu" 
                " items from the buffer, buffer only contains %zu items.\n",
-               buffer->name, n, buffer->used);
+               buffer->name, n, used);
         exit(EXIT_FAILURE);
     }
 
-    updateIndex(&buffer->read, n, buffer->size);
-    buffer->used -= n;
+    advanceRead(buffer, n);
 }
 
 // Copies 'n' samples from buffer 'src' to buffer 'dest'.
 void copyBuffer(buffer_t *dest, buffer_t *src, size_t n) {
-     if (n > src->used) {
+    const size_t srcUsed = usedInBuffer(src);
+    size_t skip = 0;
+    size_t droppedAfter = 0;
+
+    if (n > srcUsed && src->policy != BUFFER_POLICY_FAIL) {
+        // Underrun, copy everything there is
+        src->underrunSamples += n - srcUsed;
+        n = srcUsed;
+    }
+
+     if (n > srcUsed) {
         printf("Error in 'copyBuffer' (%s to %s): trying to copy %zu items"
                " from the source buffer, buffer contains %zu items.\n", 
-               src->name, dest->name, n, src->used);
+               src->name, dest->name, n, srcUsed);
         exit(EXIT_FAILURE);
     }
 
-    if (n > dest->size || n > dest->size - dest->used) {
-        printf("Error in 'copyBuffer' (%s to %s): trying to copy %zu items"
-               " to the destination buffer, buffer has room for an" 
-               " additional %zu items (currently storing %zu items).\n", 
-               src->name, dest->name, n, (dest->size - dest->used), 
-               dest->used);
+    const size_t room = makeRoom(dest, n);
+    if (room < n) {
+        if (dest->policy == BUFFER_POLICY_FAIL) {
+            const size_t destUsed = usedInBuffer(dest);
+            printf("Error in 'copyBuffer' (%s to %s): trying to copy %zu"
+                   " items to the destination buffer, buffer has room for"
+                   " an additional %zu items (currently storing %zu"
+                   " items).\n", src->name, dest->name, n, 
+                   (dest->size - destUsed), destUsed);
+            exit(EXIT_FAILURE);
+        }
+        // Overrun, skip the samples that don't fit
+        dest->droppedSamples += n - room;
+        skip = droppedFirst(dest) ? n - room : 0;
+        droppedAfter = n - room - skip;
+        skipTags(dest, skip);
+        n = room;
+    }
+
+    tagBufferFrom(dest, src, n, skip);
+    span_t spans[2];
+    size_t count = getReadSpans(src, n, skip, spans);
+    for (size_t i = 0; i < count; i++) {
+        writeArrayToBuffer(dest, spans[i].data, spans[i].length);
+    }
+    skipTags(dest, droppedAfter);
+} 
+
+// Splits the region of 'n' samples starting at 'index' of buffer->data into
+// at most two spans, returns the amount of spans used.
+size_t splitRegion(buffer_t *buffer, size_t index, size_t n, 
+                                                   span_t spans[2]) {
+    const size_t untilEnd = buffer->size - index;
+
+    spans[0].data = &buffer->data[index];
+    spans[1].data = buffer->data;
+    if (n <= untilEnd || buffer->mirrored) {
+        spans[0].length = n;
+        spans[1].length = 0;
+        return (n == 0) ? 0 : 1;
+    }
+    spans[0].length = untilEnd;
+    spans[1].length = n - untilEnd;
+    return 2;
+}
+
+// Gives the region of 'n' samples starting at 'offset' relative to
+// buffer->read as at most two spans, returns the amount of spans used.
+// The samples stay in the buffer, use removeFromBuffer() afterwards.
+size_t getReadSpans(buffer_t *buffer, size_t n, size_t offset,
+                                               span_t spans[2]) {
+    const size_t used = usedInBuffer(buffer);
+
+    if (n > used || offset > used - n) {
+        printf("Error in 'getReadSpans' (%s): trying to read the %zuth to"
+               " %zuth item from the buffer, buffer only contains %zu"
+               " items.\n", buffer->name, offset, offset+n, used);
+        exit(EXIT_FAILURE);
+    }
+
+    size_t index = readPosition(buffer);
+    updateIndex(&index, offset, buffer->size);
+    return splitRegion(buffer, index, n, spans);
+}
+
+// Gives the next 'n' free samples after buffer->write as at most two spans,
+// returns the amount of spans used. The samples only become part of the
+// buffer after they are filled and commitToBuffer() is called.
+size_t getWriteSpans(buffer_t *buffer, size_t n, span_t spans[2]) {
+    const size_t used = usedInBuffer(buffer);
+
+    if (n > buffer->size - used) {
+        printf("Error in 'getWriteSpans' (%s): buffer is unable to store an"
+               " extra %zu items (currently storing %zu items).\n",
+               buffer->name, n, used);
         exit(EXIT_FAILURE);
     }
 
-    for (size_t i = 0; i < n; i++) {
-        insertIntoBuffer(dest, readFromBuffer(src, i));
+    return splitRegion(buffer, writePosition(buffer), n, spans);
+}
+
+// Adds the next 'n' samples after buffer->write to the buffer, these
+// should be filled through getWriteSpans() first.
+void commitToBuffer(buffer_t *buffer, size_t n) {
+    const size_t used = usedInBuffer(buffer);
+
+    if (n > buffer->size - used) {
+        printf("Error in 'commitToBuffer' (%s): trying to add %zu items to"
+               " the buffer, buffer has room for an additional %zu items.\n",
+               buffer->name, n, (buffer->size - used));
+        exit(EXIT_FAILURE);
     }
 
-} 
+    advanceWrite(buffer, n);
+}
+
+// Handles an underrun when reading 'n' samples starting at 'offset' from a
+// buffer containing 'used' samples: the samples that are missing are set
+// to silence at the end of dest. Returns the amount that can be read.
+size_t readableOrSilence(sample_t dest[], buffer_t *src, size_t n,
+                                          size_t offset, size_t used) {
+    size_t readable = (offset < used) ? used - offset : 0;
+    if (readable >= n) return n;
+
+    memset(&dest[readable], 0, (n - readable) * sizeof(sample_t));
+    src->underrunSamples += n - readable;
+    return readable;
+}
+
+// Returns a pointer to the 'n' samples starting at 'offset' relative to
+// buffer->read if they are contiguous in memory (always the case for a
+// mirrored buffer), otherwise returns NULL.
+sample_t *getReadView(buffer_t *buffer, size_t n, size_t offset) {
+    span_t spans[2];
+    if (getReadSpans(buffer, n, offset, spans) > 1) return NULL;
+    return spans[0].data;
+}
+
+// Returns a pointer to the next 'n' free samples after buffer->write if
+// they are contiguous in memory (always the case for a mirrored buffer),
+// otherwise returns NULL. Use commitToBuffer() after filling them. Also
+// returns NULL if the policy of the buffer could not make enough room.
+sample_t *getWriteView(buffer_t *buffer, size_t n) {
+    if (buffer->policy != BUFFER_POLICY_FAIL && makeRoom(buffer, n) < n) {
+        return NULL;
+    }
+
+    span_t spans[2];
+    if (getWriteSpans(buffer, n, spans) > 1) return NULL;
+    return spans[0].data;
+}
+
+// Returns a pointer to 'n' contiguous samples starting at 'offset'
+// relative to src->read. If possible this points directly into the buffer,
+// otherwise the samples are copied into a new array which is also stored
+// in *copy and has to be free()'ed after use (*copy is NULL otherwise).
+sample_t *getContiguousFromBuffer(buffer_t *src, size_t n, size_t offset,
+                                                          sample_t **copy) {
+    const size_t used = usedInBuffer(src);
+
+    // On an underrun copyArrayFromBuffer() applies the policy instead
+    if (src->policy == BUFFER_POLICY_FAIL || 
+        (offset <= used && n <= used - offset)) {
+        sample_t *view = getReadView(src, n, offset);
+        if (view != NULL) {
+            *copy = NULL;
+            return view;
+        }
+    }
+
+    *copy = getNewEmptyArray(n);
+    copyArrayFromBuffer(*copy, src, n, offset);
+    return *copy;
+}
+
+// Copies 'n' samples of the array to the buffer with at most two memcpy()
+// calls, the caller is responsible for checking the available room.
+void writeArrayToBuffer(buffer_t *dest, const sample_t src[], size_t n) {
+    span_t spans[2];
+    size_t count = getWriteSpans(dest, n, spans);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(spans[i].data, src, spans[i].length * sizeof(sample_t));
+        src += spans[i].length;
+    }
+    commitToBuffer(dest, n);
+}
+
+// Copies 'n' samples starting at 'offset' of the buffer to the array with
+// at most two memcpy() calls, the caller is responsible for checking the
+// amount of samples available.
+void readArrayFromBuffer(sample_t dest[], buffer_t *src, size_t n,
+                                                         size_t offset) {
+    span_t spans[2];
+    size_t count = getReadSpans(src, n, offset, spans);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(dest, spans[i].data, spans[i].length * sizeof(sample_t));
+        dest += spans[i].length;
+    }
+}
 
 // Uses malloc() to get a new empty array, handles possible errors.
 // The array has to be free()'ed after use.
@@ -133,70 +609,228 @@ sample_t *copyNewArrayFromBuffer(buffer_t *src, size_t n, size_t offset) {
         exit(EXIT_FAILURE);
     }
 
-    if (n > src->used) {
+    const size_t used = usedInBuffer(src);
+
+    if (src->policy == BUFFER_POLICY_FAIL && n > used) {
         printf("Error in 'copyNewArrayFromBuffer' (%s): trying to copy %zu"
                " items from the source buffer, buffer only contains %zu" 
-               " items.\n", src->name, n, src->used);
+               " items.\n", src->name, n, used);
         exit(EXIT_FAILURE);
     }
 
-    if (n + offset > src->used) {
+    if (src->policy == BUFFER_POLICY_FAIL && n + offset > used) {
         printf("Error in 'copyNewArrayFromBuffer' (%s): trying to copy the"
                " %zuth to %zuth item from the buffer, buffer only contains"
-               " %zu items.\n", src->name, offset, offset+n, src->used);
+               " %zu items.\n", src->name, offset, offset+n, used);
         exit(EXIT_FAILURE);
     }
 
-    for (size_t i = 0; i < n; i++) {
-        array[i] = readFromBuffer(src, offset + i);
-    }
+    n = readableOrSilence(array, src, n, offset, used);
+    readArrayFromBuffer(array, src, n, offset);
     return array; 
 }
 
 // Copies the next 'n' samples from the buffer to an existing array.
 void copyArrayFromBuffer(sample_t dest[], buffer_t *src, size_t n, 
                                                          size_t offset) {
-     if (n > src->used) {
+    const size_t used = usedInBuffer(src);
+
+    if (src->policy == BUFFER_POLICY_FAIL && n > used) {
         printf("Error in 'copyArrayFromBuffer' (%s): trying to copy %zu"
                " items from the source buffer, buffer only contains %zu" 
-               " items.\n", src->name, n, src->used);
+               " items.\n", src->name, n, used);
         exit(EXIT_FAILURE);
     }
 
-    if (n + offset > src->used) {
+    if (src->policy == BUFFER_POLICY_FAIL && n + offset > used) {
         printf("Error in 'copyArrayFromBuffer' (%s): trying to copy the"
                " %zuth to %zuth item from the buffer, buffer only contains"
-               " %zu items.\n", src->name, offset, offset+n, src->used);
+               " %zu items.\n", src->name, offset, offset+n, used);
         exit(EXIT_FAILURE);
     }
 
-    for (size_t i = 0; i < n; i++) {
-        dest[i] = readFromBuffer(src, offset + i);
-    }
+    n = readableOrSilence(dest, src, n, offset, used);
+    readArrayFromBuffer(dest, src, n, offset);
 }
 
 // Copies the next 'n' samples from the array to the buffer
 void copyBufferFromArray(buffer_t *dest, sample_t src[], size_t n) {
-    if (n > dest->size - dest->used) {
-        printf("Error in 'copyBufferFromArray' (%s): destination buffer is"
-               " unable to store an extra %zu items.\n", dest->name, n);
+    const size_t room = makeRoom(dest, n);
+    size_t droppedAfter = 0;
+    if (room < n) {
+        if (dest->policy == BUFFER_POLICY_FAIL) {
+            printf("Error in 'copyBufferFromArray' (%s): destination buffer"
+                   " is unable to store an extra %zu items.\n", 
+                   dest->name, n);
+            exit(EXIT_FAILURE);
+        }
+        // Overrun, skip the samples that don't fit
+        dest->droppedSamples += n - room;
+        if (droppedFirst(dest)) {
+            src += n - room;
+            skipTags(dest, n - room);
+        } else {
+            droppedAfter = n - room;
+        }
+        n = room;
+    }
+
+    writeArrayToBuffer(dest, src, n);
+    skipTags(dest, droppedAfter);
+}
+
+// Starts keeping track of the input index of every sample written to the
+// buffer, before any sample is written. Untagged samples have the amount
+// of samples written before them as input index, which is right for the
+// buffer after the Input Task. Samples dropped on an overrun still count,
+// the sample written after them is tagged, see skipTags(). copyBuffer() copies the tags of traced
+// buffers, the producer of other samples has to use tagBuffer().
+void traceBuffer(buffer_t *buffer) {
+    buffer->tags = calloc(1, sizeof(sampleTags_t));
+    if (buffer->tags == NULL) {
+        printf("Error in 'traceBuffer' (%s): calloc failed to allocate"
+               " %zu bytes of memory.\n", buffer->name, 
+               sizeof(sampleTags_t));
         exit(EXIT_FAILURE);
     }
+}
+
+// Gives the samples that copyBuffer() copies from samples without an event
+// this event from now on, producer only.
+void setBufferEvent(buffer_t *buffer, size_t event) {
+    if (buffer->tags != NULL) buffer->tags->event = event;
+}
+
+// The next sample written to the buffer has input index inputIndex and
+// belongs to event, the samples after it have the next input indices.
+void tagBuffer(buffer_t *buffer, size_t inputIndex, size_t event) {
+    if (buffer->tags == NULL) return;
+    buffer->tags->skipped = 0;
+    pushTag(buffer->tags, buffer->tags->written, inputIndex, event);
+}
 
-    for (size_t i = 0; i < n; i++) {
-        insertIntoBuffer(dest, src[i]);
+// The next 'n' samples written to 'dest' are the 'n' samples at 'offset'
+// relative to src->read, called by the task between both buffers.
+void tagBufferFrom(buffer_t *dest, buffer_t *src, size_t n, size_t offset) {
+    if (dest->tags == NULL || src->tags == NULL || n == 0) return;
+    // The tags of src already give the input indices after dropped samples
+    dest->tags->skipped = 0;
+
+    sampleTags_t *tags = src->tags;
+    const size_t first = tags->read + offset;
+    const size_t position = dest->tags->written;
+    const size_t event = dest->tags->event;
+
+    sampleTag_t tag = tagOfBuffer(src, offset);
+    pushTag(dest->tags, position, tag.inputIndex, 
+            tag.event != 0 ? tag.event : event);
+
+    // Every later tag inside the samples starts another block in dest
+    const size_t pushed = pushedTags(tags);
+    for (size_t k = poppedTags(tags); k < pushed; k++) {
+        sampleTag_t *next = &tags->ring[k % SAMPLE_TAGS_SIZE];
+        if (next->position <= first) continue;
+        if (next->position >= first + n) break;
+        pushTag(dest->tags, position + (next->position - first),
+                next->inputIndex, next->event != 0 ? next->event : event);
     }
 }
 
+// Where the sample at 'offset' relative to buffer->read came from,
+// consumer only. Without traceBuffer() the result has no event.
+sampleTag_t tagOfBuffer(buffer_t *buffer, size_t offset) {
+    sampleTag_t tag = { .position = offset, .inputIndex = offset, 
+                        .event = 0 };
+    sampleTags_t *tags = buffer->tags;
+    if (tags == NULL) return tag;
+
+    tag.position = tags->read + offset;
+    tag.inputIndex = tag.position;
+    // The last tag at or before the sample applies to it
+    const size_t pushed = pushedTags(tags);
+    for (size_t k = poppedTags(tags); k < pushed; k++) {
+        sampleTag_t *before = &tags->ring[k % SAMPLE_TAGS_SIZE];
+        if (before->position > tag.position) break;
+        tag.inputIndex = before->inputIndex + 
+                         (tag.position - before->position);
+        tag.event = before->event;
+    }
+    return tag;
+}
+
+// Adds a tag, producer only. Nothing is added when the samples already
+// have this input index and event without it.
+void pushTag(sampleTags_t *tags, size_t position, size_t inputIndex,
+                                                  size_t event) {
+    const size_t pushed = pushedTags(tags);
+    if (pushed != 0) {
+        // The last tag is never removed, see popTags()
+        sampleTag_t *last = &tags->ring[(pushed - 1) % SAMPLE_TAGS_SIZE];
+        if (last->event == event && 
+            last->inputIndex + (position - last->position) == inputIndex) {
+            return;
+        }
+    } else if (event == 0 && inputIndex == position) {
+        return;
+    }
+
+    if (pushed - poppedTags(tags) == SAMPLE_TAGS_SIZE) {
+        tags->droppedTags++;
+        return;
+    }
+    sampleTag_t tag = { .position = position, .inputIndex = inputIndex,
+                        .event = event };
+    tags->ring[pushed % SAMPLE_TAGS_SIZE] = tag;
+    setPushedTags(tags, pushed + 1);
+}
+
+// Counts 'n' samples that were dropped instead of written to the buffer,
+// producer only. Their input indices are skipped, so the samples written
+// after them keep their own input index.
+void skipTags(buffer_t *buffer, size_t n) {
+    if (buffer->tags != NULL) buffer->tags->skipped += n;
+}
+
+// Tags the next sample written with the input index after the skipped
+// samples, producer only. Called before the sample is published.
+void tagSkippedSamples(sampleTags_t *tags) {
+    if (tags->skipped == 0) return;
+
+    size_t inputIndex = tags->written;
+    size_t event = 0;
+    const size_t pushed = pushedTags(tags);
+    if (pushed != 0) {
+        sampleTag_t *last = &tags->ring[(pushed - 1) % SAMPLE_TAGS_SIZE];
+        inputIndex = last->inputIndex + (tags->written - last->position);
+        event = last->event;
+    }
+    inputIndex += tags->skipped;
+    tags->skipped = 0;
+    pushTag(tags, tags->written, inputIndex, event);
+}
+
+// Removes the tags that no longer apply to any sample in the buffer,
+// consumer only. A tag applies until the next tag, so the last one stays.
+void popTags(sampleTags_t *tags) {
+    const size_t pushed = pushedTags(tags);
+    size_t popped = poppedTags(tags);
+    while (popped + 1 < pushed && 
+           tags->ring[(popped + 1) % SAMPLE_TAGS_SIZE].position <= 
+                                                            tags->read) {
+        popped++;
+    }
+    setPoppedTags(tags, popped);
+}
+
 // Prints which sections of the buffer contain data, checks stepSize
 // indexes at a time. Prints "|" if atleast one of the indexes contain
 // data, otherwise prints "-". Used for testing only.
 void printStatusBuffer(buffer_t *buffer) {
     const size_t stepSize = buffer->size / resolutionPrintStatus;
    
-    const size_t firstIndex = buffer->read;
-    size_t lastIndex = buffer->read;
-    updateIndex(&lastIndex, buffer->used, buffer->size);
+    const size_t firstIndex = readPosition(buffer);
+    size_t lastIndex = firstIndex;
+    updateIndex(&lastIndex, usedInBuffer(buffer), buffer->size);
     
     printf("["); 
     for (size_t i = 0; i < 100; i++) {
@@ -220,6 +854,27 @@ void printStatusBuffer(buffer_t *buffer) {
     printf("]\n");
 }
 
+// Prints the overrun and underrun statistics of the buffer, can be used to
+// see how close the pipeline gets to saturation during long runs.
+void printStatisticsBuffer(buffer_t *buffer) {
+    printf("%s: high-water mark %zu/%zu (%.1f%%), %zu samples dropped,"
+           " %zu samples underrun\n", buffer->name, buffer->highWaterMark,
+           buffer->size, 100.0 * buffer->highWaterMark / buffer->size,
+           buffer->droppedSamples, buffer->underrunSamples);
+    if (buffer->tags != NULL && buffer->tags->droppedTags != 0) {
+        printf("%s: %zu tags dropped, the input index of some samples is"
+               " wrong\n", buffer->name, buffer->tags->droppedTags);
+    }
+}
+
 void freeBuffer(buffer_t *buffer) {
+    free(buffer->tags);
+    buffer->tags = NULL;
+#ifdef __linux__
+    if (buffer->mirrored) {
+        munmap(buffer->data, 2 * buffer->size * sizeof(sample_t));
+        return;
+    }
+#endif /* __linux__ */
     free(buffer->data);
 }
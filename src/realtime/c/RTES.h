@@ -9,10 +9,22 @@
 #include "FreeRTOS.h"
 #endif /* USE_TEMPFREERTOS */
 
+// Define USE_SPSC_BUFFER (e.g. with -DUSE_SPSC_BUFFER) to make buffer_t
+// safe to use by one producer and one consumer task running on different
+// threads without locks. Without it the tasks have to share one thread.
+#ifdef USE_SPSC_BUFFER
+#include <stdatomic.h>
+// The indices of the producer and the consumer are kept on separate cache
+// lines, so they don't invalidate each others cache line on every update.
+#define CACHE_LINE_SIZE 64
+#endif /* USE_SPSC_BUFFER */
+
 #include "data.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
 
 typedef struct {
 // Name of the task in FreeRTOS.
@@ -25,6 +37,55 @@ typedef struct {
     void *test;
 } baseSettings_t;
 
+// What a buffer does when more samples are written than it has room for
+// (overrun), or more samples are read or removed than it contains 
+// (underrun). Except for BUFFER_POLICY_FAIL an underrun reads as silence.
+typedef enum {
+    BUFFER_POLICY_FAIL, // Print an error and exit (default)
+    BUFFER_POLICY_DROP_NEWEST, // Discard the samples that don't fit
+    BUFFER_POLICY_DROP_OLDEST, // Remove the oldest samples to make room,
+                               // with USE_SPSC_BUFFER the producer can't
+                               // do this so it acts as DROP_NEWEST
+    BUFFER_POLICY_BLOCK // Wait up to blockTimeoutUs for the consumer to
+                        // make room, then act as DROP_NEWEST
+} bufferPolicy_t;
+
+// Where the samples in a buffer came from, so the latency between the
+// Input and the Output Task can be measured, see traceBuffer(). A tag
+// gives the input index of the sample at its position, the samples after
+// it have the next input indices until the next tag.
+typedef struct {
+    size_t position; // Amount of samples written to the buffer before it
+    size_t inputIndex; // Amount of samples the Input Task took before it
+    size_t event; // Noise the sample belongs to, 0 if none
+} sampleTag_t;
+
+// Maximum amount of tags a buffer can hold at once
+#define SAMPLE_TAGS_SIZE 256
+
+typedef struct {
+    sampleTag_t ring[SAMPLE_TAGS_SIZE];
+    // Event given to samples copied from samples without one, see 
+    // setBufferEvent(), producer only
+    size_t event;
+    // Total amount of samples written and read, an untagged sample has the
+    // amount of samples written before it as input index
+    size_t written; // Producer only
+    size_t read; // Consumer only
+    // Samples dropped after the last sample written, the next sample
+    // written is tagged with the input index after them, producer only
+    size_t skipped;
+    size_t droppedTags; // Tags that didn't fit in the ring
+#ifndef USE_SPSC_BUFFER
+    size_t pushed; // Total amount of tags ever added
+    size_t popped; // Total amount of tags ever removed
+#else
+    _Atomic size_t pushed; // Producer only (release)
+    _Atomic size_t popped; // Consumer only (release)
+#endif /* USE_SPSC_BUFFER */
+} sampleTags_t;
+
+#ifndef USE_SPSC_BUFFER
 typedef struct {
     sample_t *data; // Pointer to data, created by createBuffer()
     const char *name; // Name of the buffer (used for testing)
@@ -32,23 +93,78 @@ typedef struct {
     size_t write; // Index to write the next value to
     size_t used; // Amount of sample_t values currently stored
     size_t size; // Amount of sample_t values can be stored
+    bool mirrored; // data is mapped twice back to back, see 
+                   // createMirroredBuffer()
+    bufferPolicy_t policy; // See setBufferPolicy()
+    unsigned long blockTimeoutUs; // Used by BUFFER_POLICY_BLOCK
+    size_t droppedSamples; // Samples discarded because of overruns
+    size_t underrunSamples; // Samples missing because of underruns
+    size_t highWaterMark; // Highest amount of samples ever stored
+    sampleTags_t *tags; // NULL unless traceBuffer() was called
 } buffer_t; 
+#else
+typedef struct {
+    sample_t *data; // Pointer to data, created by createBuffer()
+    const char *name; // Name of the buffer (used for testing)
+    size_t size; // Amount of sample_t values can be stored
+    bool mirrored; // data is mapped twice back to back, see 
+                   // createMirroredBuffer()
+    bufferPolicy_t policy; // See setBufferPolicy()
+    unsigned long blockTimeoutUs; // Used by BUFFER_POLICY_BLOCK
+    // Total amount of sample_t values ever written, only the producer
+    // changes this (release), index is write % size
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t write;
+    size_t droppedSamples; // Samples discarded because of overruns
+    size_t highWaterMark; // Highest amount of samples ever stored
+    // Total amount of sample_t values ever read, only the consumer
+    // changes this (release), index is read % size
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t read;
+    size_t underrunSamples; // Samples missing because of underruns
+    sampleTags_t *tags; // NULL unless traceBuffer() was called
+} buffer_t;
+#endif /* USE_SPSC_BUFFER */
+
+// A contiguous region of the memory of a buffer. The readable or writable
+// region of a buffer consists of at most two spans, the second one only
+// exists when the region wraps around the end of buffer->data.
+typedef struct {
+    sample_t *data; // Pointer to the first sample of the region
+    size_t length; // Amount of sample_t values in the region
+} span_t;
 
 // The variable which defines in how many steps the printStatusBuffer()
 // function will print the sections of the buffer which contain data
 static const size_t resolutionPrintStatus = 100;
 
 buffer_t createBuffer(const char *name, size_t capacity);
+buffer_t createMirroredBuffer(const char *name, size_t capacity);
+void setBufferPolicy(buffer_t *buffer, bufferPolicy_t policy,
+                                       unsigned long blockTimeoutUs);
+size_t usedInBuffer(buffer_t *buffer);
 void insertIntoBuffer(buffer_t *buffer, sample_t data);
 sample_t readFromBuffer(buffer_t *buffer, size_t offset);
 void removeFromBuffer(buffer_t *buffer, size_t n);
 void copyBuffer(buffer_t *dest, buffer_t *src, size_t n);
+size_t getReadSpans(buffer_t *buffer, size_t n, size_t offset,
+                                               span_t spans[2]);
+size_t getWriteSpans(buffer_t *buffer, size_t n, span_t spans[2]);
+void commitToBuffer(buffer_t *buffer, size_t n);
+sample_t *getReadView(buffer_t *buffer, size_t n, size_t offset);
+sample_t *getWriteView(buffer_t *buffer, size_t n);
+sample_t *getContiguousFromBuffer(buffer_t *src, size_t n, size_t offset,
+                                                          sample_t **copy);
 sample_t *getNewEmptyArray(size_t size);
 sample_t *copyNewArrayFromBuffer(buffer_t *src, size_t n, size_t offset);
 void copyArrayFromBuffer(sample_t dest[], buffer_t *src, size_t n,
                                                          size_t offset);
 void copyBufferFromArray(buffer_t *dest, sample_t src[], size_t n);
+void traceBuffer(buffer_t *buffer);
+void setBufferEvent(buffer_t *buffer, size_t event);
+void tagBuffer(buffer_t *buffer, size_t inputIndex, size_t event);
+void tagBufferFrom(buffer_t *dest, buffer_t *src, size_t n, size_t offset);
+sampleTag_t tagOfBuffer(buffer_t *buffer, size_t offset);
 void printStatusBuffer(buffer_t *buffer);
+void printStatisticsBuffer(buffer_t *buffer);
 void freeBuffer(buffer_t *buffer);
 
 #endif /* RTES_H */
@@ -0,0 +1,129 @@
+#include "average.h"
+
+#include <stdlib.h>
+
+// The vector kernels handle sample_t as 32 bit integers
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define AVERAGE_X86
+#include <immintrin.h>
+_Static_assert(sizeof(sample_t) == 4, "the vector kernels need 32 bit samples");
+#endif
+
+void sumAboveLimitScalar(const sample_t array[], size_t size, 
+                         sample_t lowerLimit, unsigned long long *sum,
+                         size_t *count);
+
+#ifdef AVERAGE_X86
+void sumAboveLimitSSE2(const sample_t array[], size_t size, 
+                       sample_t lowerLimit, unsigned long long *sum,
+                       size_t *count);
+void sumAboveLimitAVX2(const sample_t array[], size_t size, 
+                       sample_t lowerLimit, unsigned long long *sum,
+                       size_t *count);
+#endif /* AVERAGE_X86 */
+
+void sumAboveLimit(const sample_t array[], size_t size, sample_t lowerLimit,
+                   unsigned long long *sum, size_t *count) {
+    if (size > SUM_ABOVE_LIMIT_BLOCK) {
+        printf("Error in 'sumAboveLimit': %zu samples is more than one"
+               " block of %d.\n", size, SUM_ABOVE_LIMIT_BLOCK);
+        exit(EXIT_FAILURE);
+    }
+
+#ifdef AVERAGE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        sumAboveLimitAVX2(array, size, lowerLimit, sum, count);
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        sumAboveLimitSSE2(array, size, lowerLimit, sum, count);
+        return;
+    }
+#endif /* AVERAGE_X86 */
+    sumAboveLimitScalar(array, size, lowerLimit, sum, count);
+}
+
+// abs(INT32_MIN) stays negative, so like in the vector kernels it is never
+// above a lowerLimit of zero or more
+void sumAboveLimitScalar(const sample_t array[], size_t size, 
+                         sample_t lowerLimit, unsigned long long *sum,
+                         size_t *count) {
+    for (size_t i = 0; i < size; i++) {
+        sample_t value = abs(array[i]);
+        if (value > lowerLimit) {
+            *sum += (unsigned long long) value;
+            (*count)++;
+        }
+    }
+}
+
+#ifdef AVERAGE_X86
+
+// Four samples per vector, the masked absolute values are widened into
+// two vectors of two 64 bit sums. SSE2 has no abs, so it is computed as
+// (x ^ sign) - sign.
+__attribute__((target("sse2")))
+void sumAboveLimitSSE2(const sample_t array[], size_t size, 
+                       sample_t lowerLimit, unsigned long long *sum,
+                       size_t *count) {
+    const __m128i limit = _mm_set1_epi32(lowerLimit);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sums = _mm_setzero_si128();
+    __m128i counts = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m128i value = _mm_loadu_si128((const __m128i *) &array[i]);
+        __m128i sign = _mm_srai_epi32(value, 31);
+        value = _mm_sub_epi32(_mm_xor_si128(value, sign), sign);
+        __m128i above = _mm_cmpgt_epi32(value, limit);
+        value = _mm_and_si128(value, above);
+        sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(value, zero));
+        sums = _mm_add_epi64(sums, _mm_unpackhi_epi32(value, zero));
+        counts = _mm_sub_epi32(counts, above);
+    }
+
+    unsigned long long laneSums[2];
+    uint32_t laneCounts[4];
+    _mm_storeu_si128((__m128i *) laneSums, sums);
+    _mm_storeu_si128((__m128i *) laneCounts, counts);
+    *sum += laneSums[0] + laneSums[1];
+    *count += (size_t) laneCounts[0] + laneCounts[1] + 
+                       laneCounts[2] + laneCounts[3];
+    sumAboveLimitScalar(&array[i], size - i, lowerLimit, sum, count);
+}
+
+// Eight samples per vector, widened into two vectors of four 64 bit sums
+__attribute__((target("avx2")))
+void sumAboveLimitAVX2(const sample_t array[], size_t size, 
+                       sample_t lowerLimit, unsigned long long *sum,
+                       size_t *count) {
+    const __m256i limit = _mm256_set1_epi32(lowerLimit);
+    __m256i sums = _mm256_setzero_si256();
+    __m256i counts = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        __m256i value = _mm256_loadu_si256((const __m256i *) &array[i]);
+        value = _mm256_abs_epi32(value);
+        __m256i above = _mm256_cmpgt_epi32(value, limit);
+        value = _mm256_and_si256(value, above);
+        sums = _mm256_add_epi64(sums, _mm256_cvtepu32_epi64(
+                                        _mm256_castsi256_si128(value)));
+        sums = _mm256_add_epi64(sums, _mm256_cvtepu32_epi64(
+                                        _mm256_extracti128_si256(value, 1)));
+        counts = _mm256_sub_epi32(counts, above);
+    }
+
+    unsigned long long laneSums[4];
+    uint32_t laneCounts[8];
+    _mm256_storeu_si256((__m256i *) laneSums, sums);
+    _mm256_storeu_si256((__m256i *) laneCounts, counts);
+    *sum += laneSums[0] + laneSums[1] + laneSums[2] + laneSums[3];
+    for (size_t lane = 0; lane < 8; lane++) {
+        *count += laneCounts[lane];
+    }
+    sumAboveLimitScalar(&array[i], size - i, lowerLimit, sum, count);
+}
+
+#endif /* AVERAGE_X86 */
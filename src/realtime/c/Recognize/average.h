@@ -0,0 +1,19 @@
+#ifndef AVERAGE_H
+#define AVERAGE_H
+
+#include "../RTES.h"
+
+// Adds the absolute values of the samples above lowerLimit to *sum and
+// counts them in *count. On x86 this uses AVX2 or SSE2, chosen at runtime,
+// with 64 bit accumulators in the vector lanes. At most 
+// SUM_ABOVE_LIMIT_BLOCK samples may be passed at once, so the caller can
+// check the result for an overflow once per block.
+void sumAboveLimit(const sample_t array[], size_t size, sample_t lowerLimit,
+                   unsigned long long *sum, size_t *count);
+
+// Absolute values of sample_t are below 2^31, so a block of 2^16 samples
+// sums to less than 2^47 and the 32 bit counters of the lanes do not
+// overflow either.
+#define SUM_ABOVE_LIMIT_BLOCK 65536
+
+#endif /* AVERAGE_H */
@@ -0,0 +1,86 @@
+#include "onset.h"
+#include "average.h"
+
+void createOnsetWindows(onsetWindows_t *windows, size_t segmentSize,
+                        size_t hopSize) {
+    if (hopSize == 0 || segmentSize % hopSize != 0 ||
+        hopSize > SUM_ABOVE_LIMIT_BLOCK) {
+        printf("Error in 'createOnsetWindows': segmentSize %zu has to be a"
+               " multiple of hopSize %zu.\n", segmentSize, hopSize);
+        exit(EXIT_FAILURE);
+    }
+
+    windows->hopSize = hopSize;
+    windows->hopsPerWindow = segmentSize / hopSize;
+    windows->hopSums = malloc(2 * windows->hopsPerWindow * 
+                              sizeof(unsigned long long));
+    windows->hopCounts = malloc(2 * windows->hopsPerWindow * sizeof(size_t));
+    if (windows->hopSums == NULL || windows->hopCounts == NULL) {
+        printf("Error in 'createOnsetWindows': malloc failed to allocate"
+               " %zu hops.\n", 2 * windows->hopsPerWindow);
+        exit(EXIT_FAILURE);
+    }
+
+    resetOnsetWindows(windows);
+}
+
+// Forgets all hops, both windows have to be filled again
+void resetOnsetWindows(onsetWindows_t *windows) {
+    memset(windows->hopSums, 0, 2 * windows->hopsPerWindow * 
+                                sizeof(unsigned long long));
+    memset(windows->hopCounts, 0, 2 * windows->hopsPerWindow * 
+                                  sizeof(size_t));
+    windows->nextHop = 0;
+    windows->hopsAdded = 0;
+    windows->currentSum = windows->previousSum = 0;
+    windows->currentCount = windows->previousCount = 0;
+}
+
+// Adds the absolute values above lowerLimit of hopSize new samples to the
+// current window. Unused hops in the ring are zero, so the sums are right
+// while the windows are being filled as well.
+void addHopToOnsetWindows(onsetWindows_t *windows, const sample_t hop[],
+                          sample_t lowerLimit) {
+    const size_t oldest = windows->nextHop;
+    const size_t middle = (oldest + windows->hopsPerWindow) % 
+                          (2 * windows->hopsPerWindow);
+
+    unsigned long long sum = 0;
+    size_t count = 0;
+    sumAboveLimit(hop, windows->hopSize, lowerLimit, &sum, &count);
+
+    // The oldest hop leaves the previous window, the middle hop moves from
+    // the current to the previous window
+    windows->previousSum += windows->hopSums[middle] - 
+                            windows->hopSums[oldest];
+    windows->previousCount += windows->hopCounts[middle] - 
+                              windows->hopCounts[oldest];
+    windows->currentSum += sum - windows->hopSums[middle];
+    windows->currentCount += count - windows->hopCounts[middle];
+
+    windows->hopSums[oldest] = sum;
+    windows->hopCounts[oldest] = count;
+    windows->nextHop = (oldest + 1) % (2 * windows->hopsPerWindow);
+    windows->hopsAdded++;
+}
+
+bool onsetWindowsFilled(onsetWindows_t *windows) {
+    return windows->hopsAdded >= 2 * windows->hopsPerWindow;
+}
+
+unsigned long long currentWindowAverage(onsetWindows_t *windows) {
+    if (windows->currentCount == 0) return 0;
+    return windows->currentSum / windows->currentCount;
+}
+
+unsigned long long previousWindowAverage(onsetWindows_t *windows) {
+    if (windows->previousCount == 0) return 0;
+    return windows->previousSum / windows->previousCount;
+}
+
+void freeOnsetWindows(onsetWindows_t *windows) {
+    // free(NULL) is allowed, so unused windows can be freed as well
+    free(windows->hopSums);
+    free(windows->hopCounts);
+    *windows = (onsetWindows_t) { 0 };
+}
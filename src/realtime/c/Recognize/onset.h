@@ -0,0 +1,38 @@
+#ifndef ONSET_H
+#define ONSET_H
+
+#include "../RTES.h"
+
+#include <stdbool.h>
+
+// Sums of the last two windows of segmentSize samples, updated every 
+// hopSize samples. The sums of the hops are kept in a ring, so adding a
+// hop moves one hop from the current to the previous window and drops one
+// from the previous window without summing the windows again.
+typedef struct {
+    size_t hopSize;
+    size_t hopsPerWindow;
+    // Ring of the sums and counts of the last 2 * hopsPerWindow hops,
+    // nextHop is the oldest one and is replaced next
+    unsigned long long *hopSums;
+    size_t *hopCounts;
+    size_t nextHop;
+    size_t hopsAdded;
+    // Sum and count of the samples above the limit of both windows
+    unsigned long long currentSum;
+    unsigned long long previousSum;
+    size_t currentCount;
+    size_t previousCount;
+} onsetWindows_t;
+
+void createOnsetWindows(onsetWindows_t *windows, size_t segmentSize,
+                        size_t hopSize);
+void resetOnsetWindows(onsetWindows_t *windows);
+void addHopToOnsetWindows(onsetWindows_t *windows, const sample_t hop[],
+                          sample_t lowerLimit);
+bool onsetWindowsFilled(onsetWindows_t *windows);
+unsigned long long currentWindowAverage(onsetWindows_t *windows);
+unsigned long long previousWindowAverage(onsetWindows_t *windows);
+void freeOnsetWindows(onsetWindows_t *windows);
+
+#endif /* ONSET_H */
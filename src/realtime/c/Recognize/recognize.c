@@ -2,19 +2,20 @@
 
 unsigned long long calculateAverage(sample_t array[], size_t sizeArray, 
                                                     sample_t lowerLimit);
-void addWithOverflowCheck(unsigned long long *sum, sample_t value);
+void addWithOverflowCheck(unsigned long long *sum, unsigned long long value);
 bool recognizeBegin(recognizeSettings_t *settings, sample_t *array,
                     unsigned long long *previousAverage);
 bool recognizeEnd(recognizeSettings_t *settings, sample_t *array, 
                   unsigned long long *previousAverage);
+void forwardSegment(recognizeSettings_t *settings);
+bool recognizeBeginHops(recognizeSettings_t *settings);
+void resetRecognize(recognizeSettings_t *settings);
 
 void vTaskRecognize(void *pvParameters) {
     recognizeSettings_t *settings = (recognizeSettings_t*) pvParameters;
     
-    TickType_t xTimeTaskStarted;
+    TickType_t xTimeTaskStarted = xTaskGetTickCount();
     for (;;) {
-        xTimeTaskStarted = xTaskGetTickCount();
-
         doRecognize(settings);
 
         vTaskDelayUntil(&xTimeTaskStarted, settings->base.xTaskPeriod);
@@ -22,53 +23,151 @@ void vTaskRecognize(void *pvParameters) {
 }
 
 void doRecognize(recognizeSettings_t *settings) {
-    static bool beginRecognized = false;
-    static unsigned long long previousAverage = 0;
-    static size_t samplesChecked = 0;   
+    // When streaming the next noise is only searched for after the Cancel
+    // Task has output the last one, so its size is never overwritten and
+    // the samples of the next noise can't be taken for the end of it
+    if (settings->streaming &&
+        atomic_load_explicit(settings->endedNoiseSize,
+                             memory_order_acquire) != 0) {
+        return;
+    }
+
+    if (settings->hopSize != 0 && !settings->beginRecognized) {
+        if (recognizeBeginHops(settings)) {
+            // The current window is the first segment of the noise
+            settings->samplesKept = 0;
+            settings->samplesChecked += settings->segmentSize;
+            settings->beginRecognized = true;
+            setBufferEvent(settings->outBuffer, ++settings->noiseEvents);
+            if (settings->streaming) forwardSegment(settings);
+        }
+        return;
+    }
 
-	if (settings->inBuffer->used < settings->segmentSize) return;
+    // When streaming the checked segments of the noise are not kept in 
+    // the inBuffer, so the next segment is always at the front
+    size_t offset = settings->streaming ? 0 : settings->samplesChecked;
 
-    sample_t *array = getNewEmptyArray(settings->segmentSize);
-    copyArrayFromBuffer(array, settings->inBuffer, settings->segmentSize,
-                                                   samplesChecked);
+	if (usedInBuffer(settings->inBuffer) < offset + settings->segmentSize) {
+        return;
+    }
 
-    if (!beginRecognized) {
-        if (recognizeBegin(settings, array, &previousAverage)) {
-            samplesChecked += settings->segmentSize;
-            beginRecognized = true;
+    // Points directly into the inBuffer when possible, otherwise a copy
+    sample_t *copy;
+    sample_t *array = getContiguousFromBuffer(settings->inBuffer,
+                                              settings->segmentSize,
+                                              offset, &copy);
+
+    if (!settings->beginRecognized) {
+        if (recognizeBegin(settings, array, &settings->previousAverage)) {
+            settings->samplesChecked += settings->segmentSize;
+            settings->beginRecognized = true;
+            setBufferEvent(settings->outBuffer, ++settings->noiseEvents);
+            if (settings->streaming) forwardSegment(settings);
         } else {
             //Remove the current segment from the inBuffer
             removeFromBuffer(settings->inBuffer, settings->segmentSize);
         } 
+    } else if (settings->streaming) {
+        bool ended = recognizeEnd(settings, array, 
+                                  &settings->previousAverage);
+        settings->samplesChecked += settings->segmentSize;
+        forwardSegment(settings);
+
+        // A noise that exceeds maxSamplesNoise is ended as well, as its
+        // cancelling noise has already been output
+        if (ended || settings->samplesChecked >= settings->maxSamplesNoise) {
+            // Released after the segment is in the outBuffer, so the
+            // Cancel Task sees every sample of the noise with its size
+            atomic_store_explicit(settings->endedNoiseSize,
+                                  settings->samplesChecked,
+                                  memory_order_release);
+            resetRecognize(settings);
+        }
     } else {
-        if (recognizeEnd(settings, array, &previousAverage)) {
+        if (recognizeEnd(settings, array, &settings->previousAverage)) {
             // Noise is considered to end at the end of this segment
-            samplesChecked += settings->segmentSize;
+            settings->samplesChecked += settings->segmentSize;
             
             // Copy the noise to the outBuffer for the Cancel Task
             copyBuffer(settings->outBuffer, settings->inBuffer,
-                                            samplesChecked);
+                                            settings->samplesChecked);
 
             // Remove the noise from the inBuffer
-            removeFromBuffer(settings->inBuffer, samplesChecked);
+            removeFromBuffer(settings->inBuffer, settings->samplesChecked);
             
             // Reset the variables, next period the task will start 
             // searching for the next begin of noise again
-            beginRecognized = false;
-            samplesChecked = 0;
+            resetRecognize(settings);
         } else {
-            samplesChecked += settings->segmentSize;
-            if (samplesChecked >= settings->maxSamplesNoise) {
+            settings->samplesChecked += settings->segmentSize;
+            if (settings->samplesChecked >= settings->maxSamplesNoise) {
                 // Maximum size of the noise has been exceeded, assume last
                 // recognize begin was a false positive.
-                removeFromBuffer(settings->inBuffer, samplesChecked);
-                beginRecognized = false;
-                samplesChecked = 0;
+                removeFromBuffer(settings->inBuffer, 
+                                 settings->samplesChecked);
+                resetRecognize(settings);
             }
         }
     }
 
-    free(array);
+    free(copy);
+}
+
+// Starts searching for the next begin of noise. The onset windows still
+// hold the samples before the noise, so both have to be filled again.
+void resetRecognize(recognizeSettings_t *settings) {
+    settings->beginRecognized = false;
+    settings->samplesChecked = 0;
+    if (settings->hopSize != 0) resetOnsetWindows(&settings->onset);
+}
+
+// Adds every new hop in the inBuffer to the onset windows until the
+// current window is a begin of noise. Only the current window is kept at 
+// the front of the inBuffer, so that is where the noise starts.
+bool recognizeBeginHops(recognizeSettings_t *settings) {
+    size_t *samplesKept = &settings->samplesKept;
+    onsetWindows_t *windows = &settings->onset;
+    const size_t hopSize = settings->hopSize;
+    if (windows->hopSize == 0) {
+        createOnsetWindows(windows, settings->segmentSize, hopSize);
+    }
+
+    while (usedInBuffer(settings->inBuffer) >= *samplesKept + hopSize) {
+        sample_t *copy;
+        sample_t *hop = getContiguousFromBuffer(settings->inBuffer, hopSize,
+                                                *samplesKept, &copy);
+        addHopToOnsetWindows(windows, hop, settings->lowerLimitBegin);
+        free(copy);
+
+        *samplesKept += hopSize;
+        if (*samplesKept > settings->segmentSize) {
+            removeFromBuffer(settings->inBuffer, hopSize);
+            *samplesKept -= hopSize;
+        }
+        if (!onsetWindowsFilled(windows)) continue;
+
+        // Same comparison as recognizeBegin, with the last two windows
+        unsigned long long average = currentWindowAverage(windows);
+        unsigned long long previous = previousWindowAverage(windows);
+        if (previous != 0 && 
+            average > previous * settings->factorIncreaseBegin) {
+            settings->previousAverage = average;
+            return true;
+        }
+    }
+    return false;
+}
+
+void freeRecognize(recognizeSettings_t *settings) {
+    freeOnsetWindows(&settings->onset);
+}
+
+// Moves the segment at the front of the inBuffer to the Cancel Task
+void forwardSegment(recognizeSettings_t *settings) {
+    copyBuffer(settings->outBuffer, settings->inBuffer, 
+               settings->segmentSize);
+    removeFromBuffer(settings->inBuffer, settings->segmentSize);
 }
 
 bool recognizeBegin(recognizeSettings_t *settings, sample_t *array, 
@@ -111,12 +210,14 @@ unsigned long long calculateAverage(sample_t array[], size_t sizeArray,
     unsigned long long sum = 0;
     size_t count = 0;    
 
-    for (size_t i = 0; i < sizeArray; i++) {
-        sample_t value = abs(array[i]);
-        if (value > lowerLimit) {
-            addWithOverflowCheck(&sum, value);
-            count++;
-        }
+    // A block can not overflow the 64 bit sums of sumAboveLimit, so only
+    // the total has to be checked once per block
+    for (size_t i = 0; i < sizeArray; i += SUM_ABOVE_LIMIT_BLOCK) {
+        size_t blockSize = sizeArray - i < SUM_ABOVE_LIMIT_BLOCK ?
+                           sizeArray - i : SUM_ABOVE_LIMIT_BLOCK;
+        unsigned long long blockSum = 0;
+        sumAboveLimit(&array[i], blockSize, lowerLimit, &blockSum, &count);
+        addWithOverflowCheck(&sum, blockSum);
     }
     
     if (count == 0) {
@@ -126,13 +227,13 @@ unsigned long long calculateAverage(sample_t array[], size_t sizeArray,
     }
 }
 
-void addWithOverflowCheck(unsigned long long *sum, sample_t value) {
+void addWithOverflowCheck(unsigned long long *sum, unsigned long long value) {
     // If ULLONG_MAX - value is smaller than *sum, than *sum + value
     // exceeds ULLONG_MAX meaning an overflow will occur
-    if (ULLONG_MAX - (unsigned long long) value < *sum) {
+    if (ULLONG_MAX - value < *sum) {
             printf("Error in 'addWithOveflowCheck': addition exceeds"
                    " maximum value of unsigned long long!\n");
             exit(EXIT_FAILURE);
     }
-    *sum = *sum + (unsigned long long) value;
+    *sum = *sum + value;
 }
@@ -4,6 +4,18 @@
 #include "../RTES.h"
 #include "../data.h"
 
+#include "average.h"
+#ifndef USE_TEMPFREERTOS
+// The windows version only compiles if both .h and .c are included
+#include "average.c"
+#endif /* USE_TEMPFREERTOS */
+
+#include "onset.h"
+#ifndef USE_TEMPFREERTOS
+#include "onset.c"
+#endif /* USE_TEMPFREERTOS */
+
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <limits.h>
 
@@ -28,9 +40,38 @@ typedef struct {
     float factorIncreaseBegin;
     // An decrease of this factor or lower may be the end of noise
     float factorDecreaseEnd;
+    // Forward every segment of the noise to the Cancel Task as soon as it
+    // is checked, instead of the whole noise after its end is found
+    bool streaming;
+    // Size of the noise, published after its last segment has been
+    // forwarded when streaming, see cancelSettings_t.endedNoiseSize
+    _Atomic size_t *endedNoiseSize;
+    // If not 0 the begin of noise is checked every hopSize samples, by
+    // comparing the last two windows of segmentSize samples. segmentSize
+    // has to be a multiple of hopSize and the task has to run every 
+    // hopSize samples.
+    size_t hopSize;
+    // Window sums for hopSize, created by the first call
+    onsetWindows_t onset;
+
+    // State of the task, kept here so every stream has its own
+    // Recognize Task. Set to false and 0 before the first call.
+    bool beginRecognized;
+    // Average of the last segment when searching for the begin of noise,
+    // average of the first segment of the noise when searching its end
+    unsigned long long previousAverage;
+    // Samples of the noise that have been checked
+    size_t samplesChecked;
+    // Samples of the current window at the front of the inBuffer that 
+    // were already added to the onset windows
+    size_t samplesKept;
+    // Amount of begins of noise recognized, the samples of the noise are
+    // tagged with it as their event in the outBuffer (when it is traced)
+    size_t noiseEvents;
 } recognizeSettings_t;
 
 void vTaskRecognize(void *pvParameters);
 void doRecognize(recognizeSettings_t *settings);
+void freeRecognize(recognizeSettings_t *settings);
 
 #endif /* RECOGNIZE_H */
@@ -0,0 +1,175 @@
+#include "Cancel/cancel.h"
+
+#include <time.h>
+
+#include "RTES.h"
+
+// Transform sizes to compare, the sizes with a large prime factor are the
+// worst case for kissfft and are the ones Bluestein's algorithm is for.
+static const size_t benchmarkSizes[] = {
+    882,        // 20 ms at 44.1 kHz, only small factors
+    4410,       // 100 ms at 44.1 kHz
+    44100,      // 1 s at 44.1 kHz
+    1009,       // prime
+    4409,       // prime
+    8819,       // prime
+    2 * 4409,   // two times a prime
+    44071,      // prime close to 44100
+};
+
+// Noise sizes of the realtime pipeline for the Cancel Task benchmark
+static const size_t cancelSizes[] = { 882, 1764, 2646, 3528, 4410 };
+// Capacity of the buffers of the Cancel Task benchmark, a multiple of 100
+// for createBuffer()
+#define CANCEL_BUFFER_SIZE 4500
+
+// Each size is timed for at least this long
+#define BENCHMARK_MIN_SECONDS 0.5
+
+double secondsSince(struct timespec *start);
+double timeTransforms(fftPlan_t *plan, kiss_fft_cfg direct,
+                      const kiss_fft_cpx *in, kiss_fft_cpx *out);
+double relativeError(const kiss_fft_cpx *expected, const kiss_fft_cpx *actual,
+                     size_t size);
+void benchmarkCancel(void);
+
+int main(void) {
+    const size_t nSizes = sizeof(benchmarkSizes) / sizeof(benchmarkSizes[0]);
+
+    printf("%8s %10s %14s %14s %8s %12s\n", "size", "bluestein",
+           "kissfft (us)", "plan (us)", "speedup", "rel. error");
+
+    for (size_t s = 0; s < nSizes; s++) {
+        const size_t size = benchmarkSizes[s];
+        fftPlanCache_t cache = { 0 };
+        fftPlan_t *plan = getFFTPlan(&cache, size, false);
+        kiss_fft_cfg direct = kiss_fft_alloc(size, 0, 0, 0);
+
+        kiss_fft_cpx *in = malloc(size * sizeof(kiss_fft_cpx));
+        kiss_fft_cpx *expected = malloc(size * sizeof(kiss_fft_cpx));
+        kiss_fft_cpx *actual = malloc(size * sizeof(kiss_fft_cpx));
+        if (direct == NULL || in == NULL || expected == NULL || 
+            actual == NULL) {
+            printf("Error in 'main': malloc failed for %zu samples.\n", size);
+            exit(EXIT_FAILURE);
+        }
+
+        // Real input like in the pipeline, the same sequence for every size
+        srand(1);
+        for (size_t i = 0; i < size; i++) {
+            in[i].r = rand() % 4096 - 2048;
+            in[i].i = 0;
+        }
+
+        double directTime = timeTransforms(NULL, direct, in, expected);
+        double planTime = timeTransforms(plan, NULL, in, actual);
+
+        printf("%8zu %10s %14.1f %14.1f %7.1fx %12.2e\n", size,
+               plan->bluestein.nfft != 0 ? "yes" : "no", directTime * 1e6,
+               planTime * 1e6, directTime / planTime,
+               relativeError(expected, actual, size));
+
+        free(in);
+        free(expected);
+        free(actual);
+        kiss_fft_free(direct);
+        freeFFTPlanCache(&cache);
+    }
+
+    benchmarkCancel();
+    return 0;
+}
+
+// Times doCancel() on noise of the pipeline sizes, including the
+// conversion of the samples, to compare the FIXED_POINT build with the
+// floating-point build.
+void benchmarkCancel(void) {
+    const size_t nSizes = sizeof(cancelSizes) / sizeof(cancelSizes[0]);
+#ifdef FIXED_POINT
+    const char *build = "fixed-point";
+#else
+    const char *build = "floating-point";
+#endif /* FIXED_POINT */
+
+    printf("\nCancel Task, %s build\n", build);
+    printf("%8s %14s %16s\n", "size", "doCancel (us)", "Msamples/s");
+
+    for (size_t s = 0; s < nSizes; s++) {
+        const size_t size = cancelSizes[s];
+        buffer_t inBuffer = createBuffer("benchmarkIn", CANCEL_BUFFER_SIZE);
+        buffer_t outBuffer = createBuffer("benchmarkOut", CANCEL_BUFFER_SIZE);
+        cancelSettings_t settings = {
+            .inBuffer = &inBuffer,
+            .outBuffer = &outBuffer,
+            .cancelPercentage = 90,
+            .mode = CANCEL_MODE_EVENT
+        };
+        sample_t *noise = getNewEmptyArray(size);
+        srand(1);
+        for (size_t i = 0; i < size; i++) {
+            noise[i] = rand() % 4096 - 2048;
+        }
+
+        struct timespec start;
+        size_t runs = 0;
+        double elapsed;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        do {
+            copyBufferFromArray(&inBuffer, noise, size);
+            doCancel(&settings);
+            removeFromBuffer(&outBuffer, size);
+            runs++;
+            elapsed = secondsSince(&start);
+        } while (elapsed < BENCHMARK_MIN_SECONDS);
+
+        printf("%8zu %14.1f %16.2f\n", size, elapsed / runs * 1e6,
+               runs * size / elapsed / 1e6);
+
+        free(noise);
+        freeCancel(&settings);
+        freeBuffer(&inBuffer);
+        freeBuffer(&outBuffer);
+    }
+}
+
+double secondsSince(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Returns the average time of one transform with the plan, or with the
+// kissfft state direct if plan is NULL.
+double timeTransforms(fftPlan_t *plan, kiss_fft_cfg direct,
+                      const kiss_fft_cpx *in, kiss_fft_cpx *out) {
+    struct timespec start;
+    size_t transforms = 0;
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        if (plan != NULL) {
+            planFFT(plan, in, out);
+        } else {
+            kiss_fft(direct, in, out);
+        }
+        transforms++;
+        elapsed = secondsSince(&start);
+    } while (elapsed < BENCHMARK_MIN_SECONDS);
+
+    return elapsed / transforms;
+}
+
+// Largest difference between two spectra relative to the largest bin.
+double relativeError(const kiss_fft_cpx *expected, const kiss_fft_cpx *actual,
+                     size_t size) {
+    double maxError = 0, maxMagnitude = 0;
+    for (size_t i = 0; i < size; i++) {
+        double error = hypot(expected[i].r - actual[i].r,
+                             expected[i].i - actual[i].i);
+        double magnitude = hypot(expected[i].r, expected[i].i);
+        if (error > maxError) maxError = error;
+        if (magnitude > maxMagnitude) maxMagnitude = magnitude;
+    }
+    return maxMagnitude > 0 ? maxError / maxMagnitude : 0;
+}
@@ -0,0 +1,414 @@
+#include "RTES.h"
+#include "Input/wavreader.h"
+#include "Output/wavwriter.h"
+
+#include <stdint.h>
+#include <string.h>
+
+// Converts recordings between WAV, raw, CSV and C header (data.h) files
+// without loading them into memory, replacing the Python scripts.
+// Usage: ./convert [-r sampleRate] input output [input output ...]
+// The format of every file follows from its extension:
+//   .wav  PCM WAV, 8/16/24/32 bit input (first channel), 16 bit output
+//   .raw  mono int16_t little-endian samples without a header
+//   .csv  comma separated integers, like the output of main_ubuntu.c
+//   .h    data.h for main_ubuntu.c (output only)
+// Raw and CSV files have no sample rate, -r sets it (default 44100).
+
+#define DEFAULT_SAMPLE_RATE 44100
+// Amount of samples converted at a time
+#define CONVERT_BLOCK_SAMPLES 65536
+// Size of the blocks of text that are parsed or formatted at a time
+#define TEXT_BLOCK_SIZE (64 * 1024)
+// Longest formatted sample: "-2147483648," and a newline
+#define MAX_SAMPLE_TEXT 13
+
+typedef enum {
+    FORMAT_WAV,
+    FORMAT_RAW,
+    FORMAT_CSV,
+    FORMAT_HEADER
+} fileFormat_t;
+
+typedef struct {
+    fileFormat_t format;
+    wavReader_t wav;
+    FILE *fp;
+    size_t index;
+    // CSV input: block of text and the number being parsed, which may
+    // continue in the next block
+    char text[TEXT_BLOCK_SIZE];
+    size_t textUsed;
+    size_t textRead;
+    bool inNumber;
+    bool negative;
+    int64_t value;
+} sampleSource_t;
+
+typedef struct {
+    fileFormat_t format;
+    wavWriter_t wav;
+    FILE *fp;
+    size_t numberOfSamples;
+    // CSV and header output: block of formatted text
+    char text[TEXT_BLOCK_SIZE];
+    size_t textUsed;
+} sampleSink_t;
+
+fileFormat_t formatOfPath(const char *path);
+void openSource(sampleSource_t *source, const char *path);
+size_t readSamples(sampleSource_t *source, sample_t samples[], size_t n);
+size_t parseCSV(sampleSource_t *source, sample_t samples[], size_t n);
+void closeSource(sampleSource_t *source);
+void openSink(sampleSink_t *sink, const char *path, const char *inputPath,
+              uint32_t sampleRate);
+void writeSamples(sampleSink_t *sink, const sample_t samples[], size_t n);
+void writeText(sampleSink_t *sink, const char *text);
+void flushText(sampleSink_t *sink);
+void closeSink(sampleSink_t *sink);
+size_t formatSample(char *text, sample_t sample);
+int16_t saturateToInt16(sample_t sample);
+FILE *openFile(const char *path, const char *mode);
+void convertFile(const char *inputPath, const char *outputPath,
+                 uint32_t sampleRate);
+
+int main(int argc, char *argv[]) {
+    uint32_t sampleRate = DEFAULT_SAMPLE_RATE;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        sampleRate = (uint32_t) strtoul(argv[2], NULL, 10);
+        first = 3;
+    }
+    if (argc - first < 2 || (argc - first) % 2 != 0 || sampleRate == 0) {
+        printf("Usage: %s [-r sampleRate] input output [input output ...]\n"
+               "Formats: .wav, .raw (int16), .csv and .h (output only)\n",
+               argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    for (int i = first; i < argc; i += 2) {
+        convertFile(argv[i], argv[i + 1], sampleRate);
+    }
+    return 0;
+}
+
+void convertFile(const char *inputPath, const char *outputPath,
+                 uint32_t sampleRate) {
+    // Both contain blocks of text, too large for the stack
+    sampleSource_t *source = malloc(sizeof(sampleSource_t));
+    sampleSink_t *sink = malloc(sizeof(sampleSink_t));
+    sample_t *samples = malloc(CONVERT_BLOCK_SAMPLES * sizeof(sample_t));
+    if (source == NULL || sink == NULL || samples == NULL) {
+        printf("Error in 'convertFile': malloc failed.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    openSource(source, inputPath);
+    if (source->format == FORMAT_WAV) sampleRate = source->wav.sampleRate;
+    openSink(sink, outputPath, inputPath, sampleRate);
+
+    size_t n;
+    while ((n = readSamples(source, samples, CONVERT_BLOCK_SAMPLES)) > 0) {
+        writeSamples(sink, samples, n);
+    }
+    printf("%s -> %s: %zu samples\n", inputPath, outputPath,
+           sink->numberOfSamples);
+
+    closeSink(sink);
+    closeSource(source);
+    free(source);
+    free(sink);
+    free(samples);
+}
+
+fileFormat_t formatOfPath(const char *path) {
+    const char *extension = strrchr(path, '.');
+    if (extension != NULL) {
+        if (strcmp(extension, ".wav") == 0) return FORMAT_WAV;
+        if (strcmp(extension, ".raw") == 0) return FORMAT_RAW;
+        if (strcmp(extension, ".csv") == 0) return FORMAT_CSV;
+        if (strcmp(extension, ".txt") == 0) return FORMAT_CSV;
+        if (strcmp(extension, ".h") == 0) return FORMAT_HEADER;
+    }
+    printf("Error in 'formatOfPath': unknown format of %s.\n", path);
+    exit(EXIT_FAILURE);
+}
+
+FILE *openFile(const char *path, const char *mode) {
+    FILE *fp = fopen(path, mode);
+    if (fp == NULL) {
+        printf("Error in 'openFile': could not open %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+    return fp;
+}
+
+void openSource(sampleSource_t *source, const char *path) {
+    memset(source, 0, sizeof(sampleSource_t));
+    source->format = formatOfPath(path);
+
+    switch (source->format) {
+    case FORMAT_WAV:
+        openWavReader(&source->wav, path);
+        break;
+    case FORMAT_RAW:
+    case FORMAT_CSV:
+        source->fp = openFile(path, "rb");
+        break;
+    case FORMAT_HEADER:
+        printf("Error in 'openSource': %s, a header can only be an"
+               " output.\n", path);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Reads up to n samples, returns 0 at the end of the file
+size_t readSamples(sampleSource_t *source, sample_t samples[], size_t n) {
+    size_t count = 0;
+
+    switch (source->format) {
+    case FORMAT_WAV:
+        while (count < n && source->index < source->wav.numberOfSamples) {
+            samples[count++] = readWavSample(&source->wav, source->index++);
+        }
+        break;
+    case FORMAT_RAW: {
+        uint8_t bytes[2 * 1024];
+        size_t read;
+        do {
+            size_t block = n - count < 1024 ? n - count : 1024;
+            read = fread(bytes, 2, block, source->fp);
+            for (size_t i = 0; i < read; i++) {
+                samples[count++] = (int16_t) (bytes[2 * i] | 
+                                              bytes[2 * i + 1] << 8);
+            }
+        } while (read == 1024 && count < n);
+        break;
+    }
+    case FORMAT_CSV:
+        count = parseCSV(source, samples, n);
+        break;
+    case FORMAT_HEADER:
+        break;
+    }
+    return count;
+}
+
+// Parses integers separated by commas and/or whitespace, a number may
+// be split over two blocks of text
+size_t parseCSV(sampleSource_t *source, sample_t samples[], size_t n) {
+    size_t count = 0;
+
+    while (count < n) {
+        if (source->textRead == source->textUsed) {
+            source->textUsed = fread(source->text, 1, TEXT_BLOCK_SIZE,
+                                     source->fp);
+            source->textRead = 0;
+            if (source->textUsed == 0) {
+                // The last number has no separator after it
+                if (source->inNumber) {
+                    samples[count++] = (sample_t) (source->negative ?
+                                            -source->value : source->value);
+                    source->index++;
+                } else if (source->negative) {
+                    printf("Error in 'parseCSV': '-' without a number at the"
+                           " end.\n");
+                    exit(EXIT_FAILURE);
+                }
+                source->inNumber = false;
+                source->negative = false;
+                source->value = 0;
+                break;
+            }
+        }
+
+        const char *text = source->text;
+        size_t i = source->textRead;
+        const size_t used = source->textUsed;
+        while (i < used && count < n) {
+            const char c = text[i++];
+            if (c >= '0' && c <= '9') {
+                source->value = source->value * 10 + (c - '0');
+                source->inNumber = true;
+                if (source->value > (int64_t) INT32_MAX + source->negative) {
+                    printf("Error in 'parseCSV': sample %zu does not fit"
+                           " in a sample_t.\n", source->index);
+                    exit(EXIT_FAILURE);
+                }
+            } else if (c == '-' && !source->inNumber && !source->negative) {
+                source->negative = true;
+            } else if (c == ',' || c == ' ' || c == '\n' || c == '\r' ||
+                       c == '\t') {
+                if (source->inNumber) {
+                    samples[count++] = (sample_t) (source->negative ?
+                                            -source->value : source->value);
+                    source->index++;
+                } else if (source->negative) {
+                    printf("Error in 'parseCSV': '-' without a number after"
+                           " sample %zu.\n", source->index);
+                    exit(EXIT_FAILURE);
+                }
+                source->inNumber = false;
+                source->negative = false;
+                source->value = 0;
+            } else {
+                printf("Error in 'parseCSV': unexpected '%c' after sample"
+                       " %zu.\n", c, source->index);
+                exit(EXIT_FAILURE);
+            }
+        }
+        source->textRead = i;
+    }
+    return count;
+}
+
+void closeSource(sampleSource_t *source) {
+    if (source->format == FORMAT_WAV) {
+        closeWavReader(&source->wav);
+    } else {
+        fclose(source->fp);
+    }
+}
+
+void openSink(sampleSink_t *sink, const char *path, const char *inputPath,
+              uint32_t sampleRate) {
+    memset(sink, 0, sizeof(sampleSink_t));
+    sink->format = formatOfPath(path);
+
+    switch (sink->format) {
+    case FORMAT_WAV:
+        openWavWriter(&sink->wav, path, sampleRate, 16, false);
+        break;
+    case FORMAT_RAW:
+    case FORMAT_CSV:
+        sink->fp = openFile(path, "wb");
+        break;
+    case FORMAT_HEADER: {
+        // The same header as wav_to_header_and_csv.py, except that
+        // numberOfSamples follows the data as it is not known before
+        sink->fp = openFile(path, "wb");
+        char rate[16];
+        snprintf(rate, sizeof(rate), "%u", sampleRate);
+        writeText(sink, "// Created by convert.c\n//  from ");
+        writeText(sink, inputPath);
+        writeText(sink, "\n\n#ifndef DATA_H\n#define DATA_H\n\n"
+                        "#include <stddef.h>\n#include <stdint.h>\n\n"
+                        "typedef int32_t sample_t;\n\n"
+                        "static const uint32_t sampleRate = ");
+        writeText(sink, rate);
+        writeText(sink, ";\n\nstatic const sample_t data[] = {\n    ");
+        break;
+    }
+    }
+}
+
+void writeSamples(sampleSink_t *sink, const sample_t samples[], size_t n) {
+    switch (sink->format) {
+    case FORMAT_WAV:
+        for (size_t i = 0; i < n; i++) writeWavSample(&sink->wav, samples[i]);
+        break;
+    case FORMAT_RAW: {
+        uint8_t bytes[2 * 1024];
+        for (size_t i = 0; i < n; i += 1024) {
+            size_t block = n - i < 1024 ? n - i : 1024;
+            for (size_t j = 0; j < block; j++) {
+                uint16_t value = (uint16_t) saturateToInt16(samples[i + j]);
+                bytes[2 * j] = (uint8_t) value;
+                bytes[2 * j + 1] = (uint8_t) (value >> 8);
+            }
+            if (fwrite(bytes, 2, block, sink->fp) != block) {
+                printf("Error in 'writeSamples': could not write %zu"
+                       " samples.\n", block);
+                exit(EXIT_FAILURE);
+            }
+        }
+        break;
+    }
+    case FORMAT_CSV:
+    case FORMAT_HEADER:
+        for (size_t i = 0; i < n; i++) {
+            if (sink->textUsed > TEXT_BLOCK_SIZE - MAX_SAMPLE_TEXT) {
+                flushText(sink);
+            }
+            char *text = &sink->text[sink->textUsed];
+            // The header needs a separator between the samples only
+            if (sink->format == FORMAT_HEADER && 
+                sink->numberOfSamples + i != 0) {
+                *text++ = ',';
+                sink->textUsed++;
+            }
+            sink->textUsed += formatSample(text, samples[i]);
+            if (sink->format == FORMAT_CSV) {
+                sink->text[sink->textUsed++] = ',';
+            }
+        }
+        break;
+    }
+    sink->numberOfSamples += n;
+}
+
+// Writes the digits of sample to text without a terminating '\0', returns
+// the amount of characters
+size_t formatSample(char *text, sample_t sample) {
+    char digits[10];
+    size_t length = 0;
+    size_t nDigits = 0;
+    // Negated as unsigned, so INT32_MIN doesn't overflow
+    uint32_t value = (uint32_t) sample;
+    if (sample < 0) {
+        text[length++] = '-';
+        value = 0U - value;
+    }
+    do {
+        digits[nDigits++] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (nDigits > 0) text[length++] = digits[--nDigits];
+    return length;
+}
+
+void writeText(sampleSink_t *sink, const char *text) {
+    size_t length = strlen(text);
+    if (sink->textUsed + length > TEXT_BLOCK_SIZE) flushText(sink);
+    if (length > TEXT_BLOCK_SIZE) {
+        fwrite(text, 1, length, sink->fp);
+        return;
+    }
+    memcpy(&sink->text[sink->textUsed], text, length);
+    sink->textUsed += length;
+}
+
+void flushText(sampleSink_t *sink) {
+    if (fwrite(sink->text, 1, sink->textUsed, sink->fp) != sink->textUsed) {
+        printf("Error in 'flushText': could not write %zu bytes.\n",
+               sink->textUsed);
+        exit(EXIT_FAILURE);
+    }
+    sink->textUsed = 0;
+}
+
+void closeSink(sampleSink_t *sink) {
+    switch (sink->format) {
+    case FORMAT_WAV:
+        closeWavWriter(&sink->wav);
+        return;
+    case FORMAT_HEADER:
+        writeText(sink, "\n};\n\nstatic const size_t numberOfSamples = "
+                        "sizeof(data) / sizeof(data[0]);\n\n"
+                        "static inline sample_t readData(size_t index) { \n"
+                        "    return data[index % numberOfSamples];\n};\n\n"
+                        "#endif /* DATA_H */\n");
+        break;
+    case FORMAT_RAW:
+    case FORMAT_CSV:
+        break;
+    }
+    flushText(sink);
+    fclose(sink->fp);
+}
+
+int16_t saturateToInt16(sample_t sample) {
+    if (sample > INT16_MAX) return INT16_MAX;
+    if (sample < INT16_MIN) return INT16_MIN;
+    return (int16_t) sample;
+}
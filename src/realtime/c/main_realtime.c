@@ -0,0 +1,154 @@
+#include "Input/input.h"
+#include "Output/output.h"
+#include "Recognize/recognize.h"
+#include "Cancel/cancel.h"
+
+#include "RTES.h"
+#include "settings.h"
+#include "monitor.h"
+#include "trace.h"
+
+// Runs the vTask functions of the pipeline in real time with the host
+// scheduler of tempFREERTOS.c, every task on its own thread, and prints
+// how late the tasks were released. Build with make_realtime.sh.
+// Usage: ./realtime [file.wav]
+
+#if !defined(USE_HOST_SCHEDULER) || !defined(USE_SPSC_BUFFER)
+#error "main_realtime.c needs USE_HOST_SCHEDULER and USE_SPSC_BUFFER"
+#endif
+
+// Parameters of vTaskTrace()
+typedef struct {
+    buffer_t **buffers; // NULL terminated
+    TickType_t xTaskPeriod;
+} traceTaskSettings_t;
+
+void vTaskStop(void *pvParameters);
+void vTaskMonitor(void *pvParameters);
+void vTaskTrace(void *pvParameters);
+
+int main(int argc, char *argv[]) {
+    wavReader_t wav;
+    uint32_t rate = sampleRate;
+    TickType_t ticks = numberOfSamples;
+    size_t bufferSize = numberOfSamples;
+    if (argc > 1) {
+        openWavReader(&wav, argv[1]);
+        rate = wav.sampleRate;
+        ticks = wav.numberOfSamples;
+        bufferSize = 4 * (size_t) rate;
+    }
+
+    buffer_t inputToRecognizeBuffer = createMirroredBuffer(
+                                        "inputToRecognize", bufferSize);
+    buffer_t recognizeToCancelBuffer = createMirroredBuffer(
+                                        "recognizeToCancel", bufferSize);
+    buffer_t cancelToOutputBuffer = createMirroredBuffer(
+                                        "cancelToOutput", bufferSize);
+    setBufferPolicy(&inputToRecognizeBuffer, BUFFER_POLICY_DROP_NEWEST, 0);
+    setBufferPolicy(&recognizeToCancelBuffer, BUFFER_POLICY_DROP_NEWEST, 0);
+    setBufferPolicy(&cancelToOutputBuffer, BUFFER_POLICY_DROP_NEWEST, 0);
+
+    // Every sample keeps the index it was taken at by the Input Task, so
+    // the latency of the cancelling noise can be reported per noise
+    traceBuffer(&inputToRecognizeBuffer);
+    traceBuffer(&recognizeToCancelBuffer);
+    traceBuffer(&cancelToOutputBuffer);
+
+    FILE *fpOutput = fopen("../csv/output.csv", "w");
+
+    createSettings(rate, &inputToRecognizeBuffer,
+                         &recognizeToCancelBuffer,
+                         &cancelToOutputBuffer, fpOutput);
+    if (argc > 1) inputSettings.wav = &wav;
+    latencyReport_t latency;
+    createLatencyReport(&latency, rate, ticks);
+    outputSettings.latency = &latency;
+    inputSettings.printProgress = false;
+
+    // The sample tasks have the highest priority, Recognize and Cancel
+    // process blocks of samples and can be preempted by them
+    xTaskCreate(vTaskInput, inputSettings.base.pcTaskName,
+                configMINIMAL_STACK_SIZE, &inputSettings,
+                configMAX_PRIORITIES - 1, NULL);
+    xTaskCreate(vTaskOutput, outputSettings.base.pcTaskName,
+                configMINIMAL_STACK_SIZE, &outputSettings,
+                configMAX_PRIORITIES - 1, NULL);
+    xTaskCreate(vTaskRecognize, recognizeSettings.base.pcTaskName,
+                configMINIMAL_STACK_SIZE, &recognizeSettings,
+                configMAX_PRIORITIES - 2, NULL);
+    xTaskCreate(vTaskCancel, cancelSettings.base.pcTaskName,
+                configMINIMAL_STACK_SIZE, &cancelSettings,
+                configMAX_PRIORITIES - 3, NULL);
+    // Collects the timing of the jobs, the Input Task has a job every tick
+    xTaskCreate(vTaskMonitor, "Monitor Task", configMINIMAL_STACK_SIZE, NULL,
+                configMAX_PRIORITIES - 4, NULL);
+#ifdef USE_TRACE
+    // The jobs of the tasks and the samples in the buffers every 1 ms are
+    // written to ../csv/trace.json at exit, see trace.h
+    buffer_t *tracedBuffers[] = { &inputToRecognizeBuffer,
+                                  &recognizeToCancelBuffer,
+                                  &cancelToOutputBuffer, NULL };
+    // 1 ms in ticks, which are samples of the input
+    traceTaskSettings_t traceSettings = { tracedBuffers, rate / 1000 };
+    openTrace("../csv/trace.json", 0);
+    xTaskCreate(vTaskTrace, "Trace Task", configMINIMAL_STACK_SIZE,
+                &traceSettings, configMAX_PRIORITIES - 4, NULL);
+#endif /* USE_TRACE */
+    xTaskCreate(vTaskStop, "Stop Task", configMINIMAL_STACK_SIZE, &ticks,
+                configMAX_PRIORITIES - 1, NULL);
+
+    // The periods are in samples, so a tick is a sample of the input
+    vTaskSetTickRate(rate);
+    vTaskStartScheduler();
+
+    fclose(fpOutput);
+    freeCancel(&cancelSettings);
+    freeRecognize(&recognizeSettings);
+    if (argc > 1) closeWavReader(&wav);
+
+    vTaskPrintSchedulerStatistics();
+    printStatisticsBuffer(&inputToRecognizeBuffer);
+    printStatisticsBuffer(&recognizeToCancelBuffer);
+    printStatisticsBuffer(&cancelToOutputBuffer);
+    printLatencyReport(&latency);
+    freeLatencyReport(&latency);
+    return 0;
+}
+
+// Ends the scheduler after the amount of ticks in pvParameters
+void vTaskStop(void *pvParameters) {
+    TickType_t *ticks = (TickType_t*) pvParameters;
+    TickType_t xTimeStarted = 0;
+
+    vTaskDelayUntil(&xTimeStarted, *ticks);
+    vTaskEndScheduler();
+    // Stops this task as well
+    vTaskDelayUntil(&xTimeStarted, 1);
+}
+
+// Collects the timing of the tasks four times per MONITOR_RING_SIZE ticks
+void vTaskMonitor(void *pvParameters) {
+    (void) pvParameters;
+    TickType_t xTimeTaskStarted = xTaskGetTickCount();
+    for (;;) {
+        vTaskCollectMonitors();
+
+        vTaskDelayUntil(&xTimeTaskStarted, MONITOR_RING_SIZE / 4);
+    }
+}
+
+// Records the amount of samples in every buffer of the settings every
+// period of the settings
+void vTaskTrace(void *pvParameters) {
+    traceTaskSettings_t *settings = (traceTaskSettings_t*) pvParameters;
+    buffer_t **buffers = settings->buffers;
+    TickType_t xTimeTaskStarted = xTaskGetTickCount();
+    for (;;) {
+        for (size_t i = 0; buffers[i] != NULL; i++) {
+            traceCounter(buffers[i]->name, usedInBuffer(buffers[i]));
+        }
+
+        vTaskDelayUntil(&xTimeTaskStarted, settings->xTaskPeriod);
+    }
+}
@@ -0,0 +1,290 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Input/input.h"
+#include "Output/output.h"
+#include "Recognize/recognize.h"
+#include "Cancel/cancel.h"
+
+#include "RTES.h"
+#include "settings.h"
+#include "simulator.h"
+
+// Runs many independent Input -> Recognize -> Cancel -> Output pipelines
+// (streams) in one process, on a fixed pool of worker threads.
+// Usage: ./server [streams] [workers]
+// The streams share the samples of data.h, every stream starts at another
+// offset in it. Stream i is run by worker i % workers, worker w is pinned
+// to CPU w % (number of CPUs). The output of stream i is written to
+// ../csv/output_stream<i>.csv, stream 0 gives the same output as
+// main_ubuntu.c.
+
+#define DEFAULT_STREAMS 8
+#define MAX_NAME_LENGTH 64
+
+// A worker runs this many ticks of a stream before it switches to its
+// next stream, so its streams progress together. The same as the period
+// of the Recognize Task.
+#define TICKS_PER_SLICE 882
+
+typedef struct {
+    size_t id;
+    char names[3][MAX_NAME_LENGTH];
+    buffer_t inputToRecognizeBuffer;
+    buffer_t recognizeToCancelBuffer;
+    buffer_t cancelToOutputBuffer;
+    FILE *fpOutput;
+    inputSettings_t input;
+    outputSettings_t output;
+    recognizeSettings_t recognize;
+    cancelSettings_t cancel;
+    simulator_t simulator;
+    // Ticks that have been run
+    size_t ticks;
+    // Time spent running the tasks of this stream
+    double seconds;
+    // Longest time spent on one slice of TICKS_PER_SLICE ticks
+    double maxSliceSeconds;
+} stream_t;
+
+typedef struct {
+    size_t id;
+    int cpu;
+    stream_t *streams;
+    size_t nStreams;
+    size_t nWorkers;
+    pthread_t thread;
+} worker_t;
+
+void createStream(stream_t *stream, size_t id, size_t nStreams);
+void freeStream(stream_t *stream);
+void runSlice(stream_t *stream, size_t ticks);
+void *runWorker(void *argument);
+void simulateInput(void *parameters);
+void simulateOutput(void *parameters);
+void simulateRecognize(void *parameters);
+void simulateCancel(void *parameters);
+double secondsSince(struct timespec *start);
+size_t parseCount(const char *argument, size_t fallback);
+void printStatisticsStream(stream_t *stream, size_t nWorkers);
+
+int main(int argc, char *argv[]) {
+    long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nCpus < 1) nCpus = 1;
+
+    size_t nStreams = parseCount(argc > 1 ? argv[1] : NULL, DEFAULT_STREAMS);
+    size_t nWorkers = parseCount(argc > 2 ? argv[2] : NULL, (size_t) nCpus);
+    if (nWorkers > nStreams) nWorkers = nStreams;
+
+    stream_t *streams = calloc(nStreams, sizeof(stream_t));
+    worker_t *workers = calloc(nWorkers, sizeof(worker_t));
+    if (streams == NULL || workers == NULL) {
+        printf("Error in 'main': calloc failed for %zu streams.\n", nStreams);
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < nStreams; i++) {
+        createStream(&streams[i], i, nStreams);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t w = 0; w < nWorkers; w++) {
+        workers[w].id = w;
+        workers[w].cpu = (int) (w % (size_t) nCpus);
+        workers[w].streams = streams;
+        workers[w].nStreams = nStreams;
+        workers[w].nWorkers = nWorkers;
+        int error = pthread_create(&workers[w].thread, NULL, runWorker,
+                                   &workers[w]);
+        if (error != 0) {
+            printf("Error in 'main': pthread_create failed for worker %zu"
+                   " (%s).\n", w, strerror(error));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (size_t w = 0; w < nWorkers; w++) {
+        pthread_join(workers[w].thread, NULL);
+    }
+    double seconds = secondsSince(&start);
+
+    printf("%6s %6s %10s %12s %10s %14s\n", "stream", "worker", "samples",
+           "time (ms)", "realtime", "max slice (us)");
+    for (size_t i = 0; i < nStreams; i++) {
+        printStatisticsStream(&streams[i], nWorkers);
+    }
+    double audioSeconds = (double) nStreams * numberOfSamples / sampleRate;
+    printf("%zu streams on %zu workers: %.1f s of audio in %.3f s (%.1fx"
+           " realtime)\n", nStreams, nWorkers, audioSeconds, seconds,
+           audioSeconds / seconds);
+
+    for (size_t i = 0; i < nStreams; i++) {
+        freeStream(&streams[i]);
+    }
+    free(streams);
+    free(workers);
+    return 0;
+}
+
+void createStream(stream_t *stream, size_t id, size_t nStreams) {
+    stream->id = id;
+    snprintf(stream->names[0], MAX_NAME_LENGTH,
+             "stream %zu inputToRecognize", id);
+    snprintf(stream->names[1], MAX_NAME_LENGTH,
+             "stream %zu recognizeToCancel", id);
+    snprintf(stream->names[2], MAX_NAME_LENGTH,
+             "stream %zu cancelToOutput", id);
+
+    stream->inputToRecognizeBuffer = createMirroredBuffer(stream->names[0],
+                                                          numberOfSamples);
+    stream->recognizeToCancelBuffer = createMirroredBuffer(stream->names[1],
+                                                           numberOfSamples);
+    stream->cancelToOutputBuffer = createMirroredBuffer(stream->names[2],
+                                                        numberOfSamples);
+    setBufferPolicy(&stream->inputToRecognizeBuffer,
+                    BUFFER_POLICY_DROP_NEWEST, 0);
+    setBufferPolicy(&stream->recognizeToCancelBuffer,
+                    BUFFER_POLICY_DROP_NEWEST, 0);
+    setBufferPolicy(&stream->cancelToOutputBuffer,
+                    BUFFER_POLICY_DROP_NEWEST, 0);
+
+    char path[MAX_NAME_LENGTH];
+    snprintf(path, MAX_NAME_LENGTH, "../csv/output_stream%zu.csv", id);
+    stream->fpOutput = fopen(path, "w");
+    if (stream->fpOutput == NULL) {
+        printf("Error in 'createStream': could not open %s.\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    // createSettings() fills the settings of main_ubuntu.c, every stream
+    // gets its own copy of them. Streams are created before the workers
+    // start, so the globals are not shared between threads.
+    createSettings(sampleRate, &stream->inputToRecognizeBuffer,
+                               &stream->recognizeToCancelBuffer,
+                               &stream->cancelToOutputBuffer,
+                               stream->fpOutput);
+    stream->input = inputSettings;
+    stream->output = outputSettings;
+    stream->recognize = recognizeSettings;
+    stream->cancel = cancelSettings;
+    stream->recognize.endedNoiseSize = &stream->cancel.endedNoiseSize;
+
+    stream->input.printProgress = false;
+    // Each stream is another channel, which starts at another sample
+    stream->input.sampleIndex = id * (numberOfSamples / nStreams);
+
+    createSimulator(&stream->simulator);
+    addSimulatorTask(&stream->simulator, stream->input.base.pcTaskName,
+                     simulateInput, &stream->input,
+                     stream->input.base.ratio, 1);
+    addSimulatorTask(&stream->simulator, stream->output.base.pcTaskName,
+                     simulateOutput, &stream->output,
+                     stream->output.base.ratio, 1);
+    addSimulatorTask(&stream->simulator, stream->recognize.base.pcTaskName,
+                     simulateRecognize, &stream->recognize,
+                     stream->recognize.base.ratio, 1);
+    addSimulatorTask(&stream->simulator, stream->cancel.base.pcTaskName,
+                     simulateCancel, &stream->cancel,
+                     stream->cancel.base.ratio, 1);
+}
+
+void freeStream(stream_t *stream) {
+    fclose(stream->fpOutput);
+    freeCancel(&stream->cancel);
+    freeRecognize(&stream->recognize);
+    freeBuffer(&stream->inputToRecognizeBuffer);
+    freeBuffer(&stream->recognizeToCancelBuffer);
+    freeBuffer(&stream->cancelToOutputBuffer);
+}
+
+// Runs the next ticks of the stream, the same as main_ubuntu.c does
+void runSlice(stream_t *stream, size_t ticks) {
+    stream->ticks += ticks;
+    runSimulator(&stream->simulator, stream->ticks);
+}
+
+void *runWorker(void *argument) {
+    worker_t *worker = (worker_t*) argument;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(worker->cpu, &cpus);
+    int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (error != 0) {
+        // Not fatal, the worker runs on any CPU instead
+        printf("Warning in 'runWorker': could not pin worker %zu to CPU %d"
+               " (%s).\n", worker->id, worker->cpu, strerror(error));
+    }
+
+    for (size_t done = 0; done < numberOfSamples; done += TICKS_PER_SLICE) {
+        size_t ticks = numberOfSamples - done < TICKS_PER_SLICE ?
+                       numberOfSamples - done : TICKS_PER_SLICE;
+
+        for (size_t i = worker->id; i < worker->nStreams;
+                                    i += worker->nWorkers) {
+            stream_t *stream = &worker->streams[i];
+            struct timespec start;
+            clock_gettime(CLOCK_MONOTONIC, &start);
+
+            runSlice(stream, ticks);
+
+            double seconds = secondsSince(&start);
+            stream->seconds += seconds;
+            if (seconds > stream->maxSliceSeconds) {
+                stream->maxSliceSeconds = seconds;
+            }
+        }
+    }
+    return NULL;
+}
+
+double secondsSince(struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double) (now.tv_sec - start->tv_sec) +
+           (double) (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+size_t parseCount(const char *argument, size_t fallback) {
+    if (argument == NULL) return fallback;
+
+    char *end;
+    long value = strtol(argument, &end, 10);
+    if (*end != '\0' || value < 1) {
+        printf("Error in 'parseCount': '%s' is not a positive number.\n",
+               argument);
+        exit(EXIT_FAILURE);
+    }
+    return (size_t) value;
+}
+
+void printStatisticsStream(stream_t *stream, size_t nWorkers) {
+    double audioSeconds = (double) stream->ticks / sampleRate;
+    printf("%6zu %6zu %10zu %12.3f %9.1fx %14.1f\n", stream->id,
+           stream->id % nWorkers, stream->ticks, stream->seconds * 1e3,
+           audioSeconds / stream->seconds, stream->maxSliceSeconds * 1e6);
+    printStatisticsBuffer(&stream->inputToRecognizeBuffer);
+    printStatisticsBuffer(&stream->recognizeToCancelBuffer);
+    printStatisticsBuffer(&stream->cancelToOutputBuffer);
+}
+
+void simulateInput(void *parameters) {
+    doInput((inputSettings_t*) parameters);
+}
+
+void simulateOutput(void *parameters) {
+    doOutput((outputSettings_t*) parameters);
+}
+
+void simulateRecognize(void *parameters) {
+    doRecognize((recognizeSettings_t*) parameters);
+}
+
+void simulateCancel(void *parameters) {
+    doCancel((cancelSettings_t*) parameters);
+}
@@ -5,34 +5,168 @@
 
 #include "RTES.h"
 #include "settings.h"
+#include "simulator.h"
+#include "trace.h"
 
-int main(void) {
-    buffer_t inputToRecognizeBuffer = createBuffer("inputToRecognize",
-                                                   numberOfSamples);
-    buffer_t recognizeToCancelBuffer = createBuffer("recognizeToCancel",
-                                                    numberOfSamples);
-    buffer_t cancelToOutputBuffer = createBuffer("cancelToOutput",
-                                                 numberOfSamples);
+void simulateInput(void *parameters);
+void simulateOutput(void *parameters);
+void simulateRecognize(void *parameters);
+void simulateCancel(void *parameters);
+void simulateTrace(void *parameters);
+
+// Usage: ./a.out [input.wav [output.wav]]
+// Without an input WAV file the samples of data.h are used. Without an
+// output WAV file the output is written to ../csv/output.csv.
+int main(int argc, char *argv[]) {
+    wavReader_t wav;
+    uint32_t rate = sampleRate;
+    size_t samples = numberOfSamples;
+    // The buffers never hold more than a noise of maxSamplesNoise (1 s)
+    // and a few segments, so a long WAV file doesn't need buffers of its 
+    // size. The data.h recording is short enough to use its size.
+    size_t bufferSize = numberOfSamples;
+    if (argc > 1) {
+        openWavReader(&wav, argv[1]);
+        rate = wav.sampleRate;
+        samples = wav.numberOfSamples;
+        bufferSize = 4 * (size_t) rate;
+    }
+
+    // Mirrored buffers let Recognize and Cancel work directly on the
+    // memory of the buffers instead of copying the samples out first
+    buffer_t inputToRecognizeBuffer = createMirroredBuffer(
+                                        "inputToRecognize", bufferSize);
+    buffer_t recognizeToCancelBuffer = createMirroredBuffer(
+                                        "recognizeToCancel", bufferSize);
+    buffer_t cancelToOutputBuffer = createMirroredBuffer(
+                                        "cancelToOutput", bufferSize);
+
+    // A task that falls behind drops samples instead of stopping the
+    // pipeline, the statistics at the end show how close the buffers got
+    // to an overrun.
+    setBufferPolicy(&inputToRecognizeBuffer, BUFFER_POLICY_DROP_NEWEST, 0);
+    setBufferPolicy(&recognizeToCancelBuffer, BUFFER_POLICY_DROP_NEWEST, 0);
+    setBufferPolicy(&cancelToOutputBuffer, BUFFER_POLICY_DROP_NEWEST, 0);
+
+    // Every sample keeps the index it was taken at by the Input Task, so
+    // the latency of the cancelling noise can be reported per noise
+    traceBuffer(&inputToRecognizeBuffer);
+    traceBuffer(&recognizeToCancelBuffer);
+    traceBuffer(&cancelToOutputBuffer);
     
-    FILE *fpOutput = fopen("../csv/output.csv", "w");
-
-    createSettings(sampleRate, &inputToRecognizeBuffer,
-                               &recognizeToCancelBuffer,
-                               &cancelToOutputBuffer, fpOutput);
-
-    for (size_t i = 1; i <= numberOfSamples; i++) {
-        if (i % inputSettings.base.ratio == 0) 
-            doInput(&inputSettings);
-        if (i % outputSettings.base.ratio == 0) 
-            doOutput(&outputSettings);
-        if (i % recognizeSettings.base.ratio == 0) 
-            doRecognize(&recognizeSettings);
-        if (i % cancelSettings.base.ratio == 0) 
-            doCancel(&cancelSettings);
-        printf("%zu\n", i);
+    wavWriter_t wavOutput;
+    FILE *fpOutput = NULL;
+    if (argc > 2) {
+        // The Output Task only fills blocks, a background thread writes
+        // them to the file
+        openWavWriter(&wavOutput, argv[2], rate, 16, true);
+    } else {
+        fpOutput = fopen("../csv/output.csv", "w");
+    }
+
+    createSettings(rate, &inputToRecognizeBuffer,
+                         &recognizeToCancelBuffer,
+                         &cancelToOutputBuffer, fpOutput);
+    if (argc > 1) inputSettings.wav = &wav;
+    latencyReport_t latency;
+    createLatencyReport(&latency, rate, samples);
+    outputSettings.latency = &latency;
+    if (argc > 2) outputSettings.wav = &wavOutput;
+
+    // The tasks run in the order they are added when their releases are
+    // due at the same tick, the same order as on the target
+    simulator_t simulator;
+    createSimulator(&simulator);
+    addSimulatorTask(&simulator, inputSettings.base.pcTaskName,
+                     simulateInput, &inputSettings,
+                     inputSettings.base.ratio, 1);
+    addSimulatorTask(&simulator, outputSettings.base.pcTaskName,
+                     simulateOutput, &outputSettings,
+                     outputSettings.base.ratio, 1);
+    addSimulatorTask(&simulator, recognizeSettings.base.pcTaskName,
+                     simulateRecognize, &recognizeSettings,
+                     recognizeSettings.base.ratio, 1);
+    addSimulatorTask(&simulator, cancelSettings.base.pcTaskName,
+                     simulateCancel, &cancelSettings,
+                     cancelSettings.base.ratio, 1);
+
+    // Every task is timed, its deadline is its xTaskPeriod. The ticks
+    // are samples, so a tick lasts 1 / rate seconds.
+    baseSettings_t *bases[] = { &inputSettings.base, &outputSettings.base,
+                                &recognizeSettings.base,
+                                &cancelSettings.base };
+    taskMonitor_t monitors[4];
+    for (size_t t = 0; t < 4; t++) {
+        createTaskMonitor(&monitors[t], bases[t]->pcTaskName);
+        monitorSimulatorTask(&simulator, t, &monitors[t],
+                             bases[t]->xTaskPeriod * 1000000000ULL / rate);
+    }
+
+#ifdef USE_TRACE
+    // The jobs of the tasks and the samples in the buffers every 1 ms are
+    // written to ../csv/trace.json at exit, see trace.h
+    buffer_t *tracedBuffers[] = { &inputToRecognizeBuffer,
+                                  &recognizeToCancelBuffer,
+                                  &cancelToOutputBuffer, NULL };
+    openTrace("../csv/trace.json", 0);
+    addSimulatorTask(&simulator, "Trace Task", simulateTrace, tracedBuffers,
+                     rate, 1000);
+#endif /* USE_TRACE */
+
+    // A task has at most one release per tick, so collecting the monitors
+    // every MONITOR_RING_SIZE ticks doesn't drop records
+    for (size_t tick = 0; tick < samples; ) {
+        tick = samples - tick < MONITOR_RING_SIZE ?
+               samples : tick + MONITOR_RING_SIZE;
+        runSimulator(&simulator, tick);
+        for (size_t t = 0; t < 4; t++) collectTaskMonitor(&monitors[t]);
+    }
+
+    if (argc > 2) {
+        closeWavWriter(&wavOutput);
+    } else {
+        fclose(fpOutput);
     }
+    freeCancel(&cancelSettings);
+    freeRecognize(&recognizeSettings);
+    if (argc > 1) closeWavReader(&wav);
 
-    fclose(fpOutput);
+    printStatisticsSimulator(&simulator);
+    for (size_t t = 0; t < 4; t++) {
+        printStatisticsTaskMonitor(&monitors[t]);
+        freeTaskMonitor(&monitors[t]);
+    }
+    printStatisticsBuffer(&inputToRecognizeBuffer);
+    printStatisticsBuffer(&recognizeToCancelBuffer);
+    printStatisticsBuffer(&cancelToOutputBuffer);
+    printLatencyReport(&latency);
+    freeLatencyReport(&latency);
+    if (argc > 2) printStatisticsWavWriter(&wavOutput);
 
     return 0;   
 }
+
+void simulateInput(void *parameters) {
+    doInput((inputSettings_t*) parameters);
+}
+
+void simulateOutput(void *parameters) {
+    doOutput((outputSettings_t*) parameters);
+}
+
+void simulateRecognize(void *parameters) {
+    doRecognize((recognizeSettings_t*) parameters);
+}
+
+void simulateCancel(void *parameters) {
+    doCancel((cancelSettings_t*) parameters);
+}
+
+// Records the amount of samples in every buffer of the NULL terminated
+// array of buffers
+void simulateTrace(void *parameters) {
+    buffer_t **buffers = (buffer_t**) parameters;
+    for (size_t i = 0; buffers[i] != NULL; i++) {
+        traceCounter(buffers[i]->name, usedInBuffer(buffers[i]));
+    }
+}
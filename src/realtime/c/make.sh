@@ -1,4 +1,5 @@
 #!/bin/bash
 
-gcc -Wall main_ubuntu.c RTES.c Input/input.c Output/output.c Recognize/recognize.c Cancel/cancel.c kissfft/kiss_fft.c -lm
+gcc -Wall -pthread -Ikissfft main_ubuntu.c simulator.c monitor.c RTES.c Input/input.c Input/wavreader.c Output/output.c Output/latency.c Output/wavwriter.c Output/asyncwriter.c Recognize/recognize.c Recognize/average.c Recognize/onset.c Cancel/cancel.c Cancel/fftplan.c Cancel/bluestein.c Cancel/spectrum.c Cancel/stft.c kissfft/kiss_fft.c kissfft/tools/kiss_fftr.c -lm
 
+gcc -Wall -O2 -pthread -Ikissfft -o convert convert.c Input/wavreader.c Output/wavwriter.c Output/asyncwriter.c
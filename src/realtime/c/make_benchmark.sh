@@ -0,0 +1,6 @@
+#!/bin/bash
+
+SOURCES="benchmark_fft.c RTES.c Cancel/cancel.c Cancel/fftplan.c Cancel/bluestein.c Cancel/spectrum.c Cancel/stft.c kissfft/kiss_fft.c kissfft/tools/kiss_fftr.c"
+
+gcc -Wall -O2 -Ikissfft -o benchmark_fft $SOURCES -lm
+gcc -Wall -O2 -DFIXED_POINT=32 -Ikissfft -o benchmark_fft_fixed $SOURCES -lm
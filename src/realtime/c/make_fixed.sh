@@ -0,0 +1,5 @@
+#!/bin/bash
+
+# Same program as make.sh, but the Cancel Task uses 32 bit fixed-point
+# kissfft transforms instead of floating-point ones.
+gcc -Wall -pthread -DFIXED_POINT=32 -Ikissfft -o a_fixed.out main_ubuntu.c simulator.c monitor.c RTES.c Input/input.c Input/wavreader.c Output/output.c Output/latency.c Output/wavwriter.c Output/asyncwriter.c Recognize/recognize.c Recognize/average.c Recognize/onset.c Cancel/cancel.c Cancel/fftplan.c Cancel/bluestein.c Cancel/spectrum.c Cancel/stft.c kissfft/kiss_fft.c kissfft/tools/kiss_fftr.c -lm
@@ -0,0 +1,3 @@
+#!/bin/bash
+
+gcc -Wall -O2 -pthread -DUSE_HOST_SCHEDULER -DUSE_SPSC_BUFFER -Ikissfft -o realtime main_realtime.c tempFREERTOS.c monitor.c RTES.c Input/input.c Input/wavreader.c Output/output.c Output/latency.c Output/wavwriter.c Output/asyncwriter.c Recognize/recognize.c Recognize/average.c Recognize/onset.c Cancel/cancel.c Cancel/fftplan.c Cancel/bluestein.c Cancel/spectrum.c Cancel/stft.c kissfft/kiss_fft.c kissfft/tools/kiss_fftr.c -lm
@@ -0,0 +1,7 @@
+#!/bin/bash
+
+# Same programs as make.sh and make_realtime.sh, but they write a Chrome
+# trace of the tasks and the buffers to ../csv/trace.json, see trace.h.
+gcc -Wall -O2 -pthread -DUSE_TRACE -Ikissfft -o a_trace.out main_ubuntu.c simulator.c monitor.c trace.c RTES.c Input/input.c Input/wavreader.c Output/output.c Output/latency.c Output/wavwriter.c Output/asyncwriter.c Recognize/recognize.c Recognize/average.c Recognize/onset.c Cancel/cancel.c Cancel/fftplan.c Cancel/bluestein.c Cancel/spectrum.c Cancel/stft.c kissfft/kiss_fft.c kissfft/tools/kiss_fftr.c -lm
+
+gcc -Wall -O2 -pthread -DUSE_HOST_SCHEDULER -DUSE_SPSC_BUFFER -DUSE_TRACE -Ikissfft -o realtime_trace main_realtime.c tempFREERTOS.c monitor.c trace.c RTES.c Input/input.c Input/wavreader.c Output/output.c Output/latency.c Output/wavwriter.c Output/asyncwriter.c Recognize/recognize.c Recognize/average.c Recognize/onset.c Cancel/cancel.c Cancel/fftplan.c Cancel/bluestein.c Cancel/spectrum.c Cancel/stft.c kissfft/kiss_fft.c kissfft/tools/kiss_fftr.c -lm
@@ -0,0 +1,158 @@
+#include "monitor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+size_t bucketOfNanoseconds(uint64_t ns);
+uint64_t nanosecondsOfBucket(size_t bucket);
+uint64_t percentileOfHistogram(const uint64_t histogram[], size_t jobs,
+                               uint64_t max, double percentile);
+
+void createTaskMonitor(taskMonitor_t *monitor, const char *name) {
+    memset(monitor, 0, sizeof(taskMonitor_t));
+    monitor->name = name;
+    monitor->ring = malloc(MONITOR_RING_SIZE * sizeof(monitorRecord_t));
+    if (monitor->ring == NULL) {
+        printf("Error in 'createTaskMonitor': malloc failed to allocate"
+               " %d records for %s.\n", MONITOR_RING_SIZE, name);
+        exit(EXIT_FAILURE);
+    }
+    atomic_init(&monitor->write, 0);
+    atomic_init(&monitor->read, 0);
+    atomic_init(&monitor->droppedRecords, 0);
+}
+
+// Nanoseconds of CLOCK_MONOTONIC, which is read without a system call
+uint64_t monitorTimestamp(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+// Only called by the task. A full ring drops the record, the task never
+// waits for the consumer.
+void pushTaskMonitor(taskMonitor_t *monitor, uint64_t releaseNs,
+                     uint64_t startNs, uint64_t endNs, uint64_t deadlineNs) {
+    size_t write = atomic_load_explicit(&monitor->write,
+                                        memory_order_relaxed);
+    size_t read = atomic_load_explicit(&monitor->read, memory_order_acquire);
+    if (write - read == MONITOR_RING_SIZE) {
+        atomic_fetch_add_explicit(&monitor->droppedRecords, 1,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    monitorRecord_t *record = &monitor->ring[write & (MONITOR_RING_SIZE - 1)];
+    record->releaseNs = releaseNs;
+    record->startNs = startNs;
+    record->endNs = endNs;
+    record->deadlineNs = deadlineNs;
+    atomic_store_explicit(&monitor->write, write + 1, memory_order_release);
+}
+
+// Moves the records in the ring into the histograms. The response time of
+// a job is from its release to its end, it misses its deadline when that
+// is longer than the deadline of the record.
+void collectTaskMonitor(taskMonitor_t *monitor) {
+    size_t read = atomic_load_explicit(&monitor->read, memory_order_relaxed);
+    size_t write = atomic_load_explicit(&monitor->write,
+                                        memory_order_acquire);
+
+    for (; read != write; read++) {
+        monitorRecord_t *record = &monitor->ring[read &
+                                                 (MONITOR_RING_SIZE - 1)];
+        uint64_t execution = record->endNs > record->startNs ?
+                             record->endNs - record->startNs : 0;
+        uint64_t response = record->endNs > record->releaseNs ?
+                            record->endNs - record->releaseNs : 0;
+
+        monitor->executionHistogram[bucketOfNanoseconds(execution)]++;
+        monitor->responseHistogram[bucketOfNanoseconds(response)]++;
+        if (execution > monitor->maxExecutionNs) {
+            monitor->maxExecutionNs = execution;
+        }
+        if (response > monitor->maxResponseNs) {
+            monitor->maxResponseNs = response;
+        }
+        if (response > record->deadlineNs) monitor->deadlineMisses++;
+        monitor->deadlineNs = record->deadlineNs;
+        monitor->jobs++;
+    }
+    atomic_store_explicit(&monitor->read, read, memory_order_release);
+}
+
+// The percentiles are of the collected records, the upper bound of the
+// bucket that contains them
+uint64_t executionPercentileTaskMonitor(taskMonitor_t *monitor,
+                                        double percentile) {
+    return percentileOfHistogram(monitor->executionHistogram, monitor->jobs,
+                                 monitor->maxExecutionNs, percentile);
+}
+
+uint64_t responsePercentileTaskMonitor(taskMonitor_t *monitor,
+                                       double percentile) {
+    return percentileOfHistogram(monitor->responseHistogram, monitor->jobs,
+                                 monitor->maxResponseNs, percentile);
+}
+
+void printStatisticsTaskMonitor(taskMonitor_t *monitor) {
+    collectTaskMonitor(monitor);
+    printf("%s: %zu jobs, execution p50 %.1f p99 %.1f max %.1f us,"
+           " response p50 %.1f p99 %.1f max %.1f us, %zu deadline misses"
+           " (%.1f us), %zu records dropped\n", monitor->name, monitor->jobs,
+           executionPercentileTaskMonitor(monitor, 50.0) / 1e3,
+           executionPercentileTaskMonitor(monitor, 99.0) / 1e3,
+           monitor->maxExecutionNs / 1e3,
+           responsePercentileTaskMonitor(monitor, 50.0) / 1e3,
+           responsePercentileTaskMonitor(monitor, 99.0) / 1e3,
+           monitor->maxResponseNs / 1e3, monitor->deadlineMisses,
+           monitor->deadlineNs / 1e3,
+           atomic_load_explicit(&monitor->droppedRecords,
+                                memory_order_relaxed));
+}
+
+void freeTaskMonitor(taskMonitor_t *monitor) {
+    free(monitor->ring);
+    monitor->ring = NULL;
+}
+
+// Bucket 16 + 8 * (msb - 4) + sub holds the values with their most
+// significant bit at msb and sub in the 3 bits below it
+size_t bucketOfNanoseconds(uint64_t ns) {
+    if (ns < 16) return (size_t) ns;
+
+    size_t msb = 63 - (size_t) __builtin_clzll(ns);
+    size_t sub = (size_t) (ns >> (msb - 3)) & (MONITOR_SUB_BUCKETS - 1);
+    return 16 + MONITOR_SUB_BUCKETS * (msb - 4) + sub;
+}
+
+// The largest value in the bucket
+uint64_t nanosecondsOfBucket(size_t bucket) {
+    if (bucket < 16) return bucket;
+
+    size_t msb = (bucket - 16) / MONITOR_SUB_BUCKETS + 4;
+    uint64_t sub = (bucket - 16) % MONITOR_SUB_BUCKETS;
+    uint64_t lowest = (MONITOR_SUB_BUCKETS + sub) << (msb - 3);
+    return lowest + (1ULL << (msb - 3)) - 1;
+}
+
+uint64_t percentileOfHistogram(const uint64_t histogram[], size_t jobs,
+                               uint64_t max, double percentile) {
+    if (jobs == 0) return 0;
+
+    // The rank of the job at the percentile, at least the first job
+    uint64_t rank = (uint64_t) (percentile / 100.0 * (double) jobs + 0.5);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < MONITOR_BUCKETS; bucket++) {
+        seen += histogram[bucket];
+        if (seen >= rank) {
+            uint64_t ns = nanosecondsOfBucket(bucket);
+            return ns < max ? ns : max;
+        }
+    }
+    return max;
+}
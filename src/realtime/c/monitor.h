@@ -0,0 +1,66 @@
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Timing of the jobs of one task, the host version of the Monitoring Task
+// of the legacy FreeRTOS build. The task (producer) pushes a record per
+// job into a lock-free ring, collectTaskMonitor() (consumer, may run on
+// another thread) moves the records into histograms of the execution and
+// response times. Only the producer pays for a push, two loads and a
+// store of the record.
+
+#ifndef MONITOR_CACHE_LINE_SIZE
+#define MONITOR_CACHE_LINE_SIZE 64
+#endif
+
+// Amount of records a ring holds, a power of two. The consumer has to
+// collect at least this often (in jobs), otherwise records are dropped.
+#define MONITOR_RING_SIZE 8192
+
+// The histograms have 8 buckets per power of two of nanoseconds, so a
+// percentile is at most 12.5% above the real value. Values below 16 ns
+// have a bucket of their own.
+#define MONITOR_SUB_BUCKETS 8
+#define MONITOR_BUCKETS (16 + 60 * MONITOR_SUB_BUCKETS)
+
+// All times in nanoseconds of CLOCK_MONOTONIC, see monitorTimestamp()
+typedef struct {
+    uint64_t releaseNs; // When the job should have started
+    uint64_t startNs; // When the job started
+    uint64_t endNs; // When the job ended
+    uint64_t deadlineNs; // Relative to releaseNs, the period of the task
+} monitorRecord_t;
+
+typedef struct {
+    const char *name;
+    monitorRecord_t *ring;
+    // Only the producer changes write and droppedRecords
+    _Alignas(MONITOR_CACHE_LINE_SIZE) _Atomic size_t write;
+    _Atomic size_t droppedRecords;
+    // Only the consumer changes read and the fields below
+    _Alignas(MONITOR_CACHE_LINE_SIZE) _Atomic size_t read;
+    size_t jobs;
+    size_t deadlineMisses;
+    uint64_t deadlineNs; // Of the last collected record
+    uint64_t maxExecutionNs;
+    uint64_t maxResponseNs;
+    uint64_t executionHistogram[MONITOR_BUCKETS];
+    uint64_t responseHistogram[MONITOR_BUCKETS];
+} taskMonitor_t;
+
+void createTaskMonitor(taskMonitor_t *monitor, const char *name);
+uint64_t monitorTimestamp(void);
+void pushTaskMonitor(taskMonitor_t *monitor, uint64_t releaseNs,
+                     uint64_t startNs, uint64_t endNs, uint64_t deadlineNs);
+void collectTaskMonitor(taskMonitor_t *monitor);
+uint64_t executionPercentileTaskMonitor(taskMonitor_t *monitor,
+                                        double percentile);
+uint64_t responsePercentileTaskMonitor(taskMonitor_t *monitor,
+                                       double percentile);
+void printStatisticsTaskMonitor(taskMonitor_t *monitor);
+void freeTaskMonitor(taskMonitor_t *monitor);
+
+#endif /* MONITOR_H */
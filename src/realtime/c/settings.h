@@ -30,6 +30,9 @@ void createSettings(uint32_t sampleRate,
     inputSettings.base.ratio = 1;
     inputSettings.base.test = NULL;
     inputSettings.outBuffer = inputToRecognizeBuffer;
+    inputSettings.sampleIndex = 0;
+    inputSettings.printProgress = true;
+    inputSettings.wav = NULL;
     
     outputSettings.base.pcTaskName = "Output Task";        
     outputSettings.base.xTaskPeriod = pdMS_TO_TICKS(1);
@@ -38,6 +41,9 @@ void createSettings(uint32_t sampleRate,
     outputSettings.base.test = NULL;
     outputSettings.inBuffer = cancelToOutputBuffer;
     outputSettings.fpOutput = fpOutput;
+    outputSettings.wav = NULL;
+    outputSettings.latency = NULL;
+    outputSettings.samplesOutput = 0;
 
     cancelSettings.base.pcTaskName = "Cancel Task";
     cancelSettings.base.xTaskPeriod = pdMS_TO_TICKS(1);
@@ -46,6 +52,18 @@ void createSettings(uint32_t sampleRate,
     cancelSettings.inBuffer = recognizeToCancelBuffer;
     cancelSettings.outBuffer = cancelToOutputBuffer;
     cancelSettings.cancelPercentage = 90;
+    // The real FFT halves the FFT time and spectrum memory, but 90% of
+    // the half-spectrum leaves almost nothing of the noise, so it needs a
+    // smaller cancelPercentage than the complex FFT
+    cancelSettings.realFFT = false;
+    // CANCEL_MODE_STREAMING starts the cancelling noise frameSize - hopSize
+    // samples (2.9 ms) after Recognize forwards the first segment of the
+    // noise instead of after its end, and only keeps one frame in memory
+    cancelSettings.mode = CANCEL_MODE_EVENT;
+    cancelSettings.frameSize = 256;
+    cancelSettings.hopSize = 128;
+    cancelSettings.endedNoiseSize = 0;
+    cancelSettings.noiseTag = (sampleTag_t) { 0, 0, 0 };
 
     recognizeSettings.base.pcTaskName = "Recognize Task";
     recognizeSettings.base.xTaskPeriod = pdMS_TO_TICKS(882); // Same as ratio
@@ -59,6 +77,23 @@ void createSettings(uint32_t sampleRate,
     recognizeSettings.lowerLimitEnd = 0;
     recognizeSettings.factorIncreaseBegin = 1.5F;
     recognizeSettings.factorDecreaseEnd = 0.75F;
+    recognizeSettings.streaming = 
+                            cancelSettings.mode == CANCEL_MODE_STREAMING;
+    recognizeSettings.endedNoiseSize = &cancelSettings.endedNoiseSize;
+    // Check for the begin of noise every hopSize samples instead of every
+    // segmentSize samples, 0 to disable. 882 is not a multiple of 64, 63
+    // (1.4 ms) is the closest hop. The task then runs every hop.
+    recognizeSettings.hopSize = 0;
+    if (recognizeSettings.hopSize != 0) {
+        recognizeSettings.base.xTaskPeriod = 
+                                pdMS_TO_TICKS(recognizeSettings.hopSize);
+        recognizeSettings.base.ratio = recognizeSettings.hopSize;
+    }
+    recognizeSettings.beginRecognized = false;
+    recognizeSettings.previousAverage = 0;
+    recognizeSettings.samplesChecked = 0;
+    recognizeSettings.samplesKept = 0;
+    recognizeSettings.noiseEvents = 0;
 }
 
 #endif /* SETTINGS_H */
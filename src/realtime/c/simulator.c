@@ -0,0 +1,197 @@
+#include "simulator.h"
+#include "trace.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+bool releasedBefore(simulator_t *simulator, size_t a, size_t b);
+bool dueAt(simulatorTask_t *task, unsigned long long tick);
+void releaseSimulatorTask(simulator_t *simulator, simulatorTask_t *task);
+void siftDown(simulator_t *simulator, size_t position);
+void siftUp(simulator_t *simulator, size_t position);
+unsigned long long greatestCommonDivisor(unsigned long long a,
+                                         unsigned long long b);
+
+void createSimulator(simulator_t *simulator) {
+    simulator->numberOfTasks = 0;
+    simulator->lastReleaseNumerator = 0;
+    simulator->lastReleaseDenominator = 1;
+    simulator->lastReleaseNs = 0;
+}
+
+// The first release of the task is due after one period
+void addSimulatorTask(simulator_t *simulator, const char *name,
+                      simulatorFunction_t function, void *parameters,
+                      unsigned long long periodNumerator,
+                      unsigned long long periodDenominator) {
+    if (simulator->numberOfTasks == SIMULATOR_MAX_TASKS) {
+        printf("Error in 'addSimulatorTask': more than %d tasks.\n",
+               SIMULATOR_MAX_TASKS);
+        exit(EXIT_FAILURE);
+    }
+    if (periodNumerator == 0 || periodDenominator == 0) {
+        printf("Error in 'addSimulatorTask': %s has a period of %llu/%llu"
+               " ticks.\n", name, periodNumerator, periodDenominator);
+        exit(EXIT_FAILURE);
+    }
+
+    const unsigned long long divisor = greatestCommonDivisor(
+                                       periodNumerator, periodDenominator);
+    const size_t index = simulator->numberOfTasks++;
+    simulatorTask_t *task = &simulator->tasks[index];
+    task->name = name;
+    task->function = function;
+    task->parameters = parameters;
+    task->periodNumerator = periodNumerator / divisor;
+    task->periodDenominator = periodDenominator / divisor;
+    task->releases = 0;
+    task->monitor = NULL;
+    task->deadlineNs = 0;
+
+    simulator->heap[index] = index;
+    siftUp(simulator, index);
+}
+
+// Pushes the timing of every release of task index to the monitor. The
+// simulated ticks take no time, so a release is the moment the simulator
+// started running the releases that are due at the same time, its
+// response time includes the tasks that ran before it at that time.
+void monitorSimulatorTask(simulator_t *simulator, size_t index,
+                          taskMonitor_t *monitor, uint64_t deadlineNs) {
+    if (index >= simulator->numberOfTasks) {
+        printf("Error in 'monitorSimulatorTask': there is no task %zu.\n",
+               index);
+        exit(EXIT_FAILURE);
+    }
+    simulator->tasks[index].monitor = monitor;
+    simulator->tasks[index].deadlineNs = deadlineNs;
+}
+
+// Runs every release that is due at or before endTick and returns the
+// amount of releases that have run. A later call continues where the
+// previous one stopped, so a simulation can be run in slices.
+unsigned long long runSimulator(simulator_t *simulator,
+                                unsigned long long endTick) {
+    unsigned long long released = 0;
+    if (simulator->numberOfTasks == 0) return 0;
+
+    for (;;) {
+        simulatorTask_t *task = &simulator->tasks[simulator->heap[0]];
+        if (!dueAt(task, endTick)) break;
+
+        releaseSimulatorTask(simulator, task);
+        released++;
+        // The next release of the task is later, it moves down the heap
+        siftDown(simulator, 0);
+    }
+    return released;
+}
+
+void releaseSimulatorTask(simulator_t *simulator, simulatorTask_t *task) {
+    task->releases++;
+#ifndef USE_TRACE
+    if (task->monitor == NULL) {
+        task->function(task->parameters);
+        return;
+    }
+#endif /* USE_TRACE */
+
+    // The first release at a new release time is where the response
+    // times of the releases at that time start
+    const unsigned long long numerator = task->releases *
+                                         task->periodNumerator;
+    const uint64_t startNs = monitorTimestamp();
+    if (numerator * simulator->lastReleaseDenominator !=
+        simulator->lastReleaseNumerator * task->periodDenominator) {
+        simulator->lastReleaseNumerator = numerator;
+        simulator->lastReleaseDenominator = task->periodDenominator;
+        simulator->lastReleaseNs = startNs;
+    }
+
+    task->function(task->parameters);
+
+    const uint64_t endNs = monitorTimestamp();
+    if (task->monitor != NULL) {
+        pushTaskMonitor(task->monitor, simulator->lastReleaseNs, startNs,
+                        endNs, task->deadlineNs);
+    }
+    traceJob(task->name, (uint32_t) (task - simulator->tasks), startNs,
+             endNs);
+}
+
+void printStatisticsSimulator(simulator_t *simulator) {
+    for (size_t i = 0; i < simulator->numberOfTasks; i++) {
+        simulatorTask_t *task = &simulator->tasks[i];
+        printf("%s: %llu releases, period %llu/%llu ticks\n", task->name,
+               task->releases, task->periodNumerator,
+               task->periodDenominator);
+    }
+}
+
+// Compares the next releases of tasks a and b, (r + 1) * n / d, without
+// dividing. The products fit in 64 bits for billions of releases of
+// periods with a numerator and denominator up to a few thousand.
+bool releasedBefore(simulator_t *simulator, size_t a, size_t b) {
+    simulatorTask_t *taskA = &simulator->tasks[a];
+    simulatorTask_t *taskB = &simulator->tasks[b];
+    unsigned long long timeA = (taskA->releases + 1) *
+                               taskA->periodNumerator *
+                               taskB->periodDenominator;
+    unsigned long long timeB = (taskB->releases + 1) *
+                               taskB->periodNumerator *
+                               taskA->periodDenominator;
+    if (timeA != timeB) return timeA < timeB;
+    return a < b;
+}
+
+bool dueAt(simulatorTask_t *task, unsigned long long tick) {
+    return (task->releases + 1) * task->periodNumerator <=
+           tick * task->periodDenominator;
+}
+
+void siftDown(simulator_t *simulator, size_t position) {
+    size_t *heap = simulator->heap;
+    for (;;) {
+        size_t first = position;
+        size_t left = 2 * position + 1;
+        size_t right = left + 1;
+        if (left < simulator->numberOfTasks &&
+            releasedBefore(simulator, heap[left], heap[first])) {
+            first = left;
+        }
+        if (right < simulator->numberOfTasks &&
+            releasedBefore(simulator, heap[right], heap[first])) {
+            first = right;
+        }
+        if (first == position) return;
+
+        size_t swap = heap[position];
+        heap[position] = heap[first];
+        heap[first] = swap;
+        position = first;
+    }
+}
+
+void siftUp(simulator_t *simulator, size_t position) {
+    size_t *heap = simulator->heap;
+    while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!releasedBefore(simulator, heap[position], heap[parent])) return;
+
+        size_t swap = heap[position];
+        heap[position] = heap[parent];
+        heap[parent] = swap;
+        position = parent;
+    }
+}
+
+unsigned long long greatestCommonDivisor(unsigned long long a,
+                                         unsigned long long b) {
+    while (b != 0) {
+        unsigned long long remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
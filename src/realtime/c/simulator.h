@@ -0,0 +1,58 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stddef.h>
+
+#include "monitor.h"
+
+// Discrete-event simulation of periodic tasks on one thread, as fast as
+// the CPU allows. The next release of every task is kept in a binary
+// min-heap, so the simulator jumps from release to release instead of
+// testing every tick. The period of a task is a fraction of ticks
+// (periodNumerator / periodDenominator), release k of a task is due at
+// tick k * period. Releases that are due at the same time run in the
+// order the tasks were added, so a simulation is always deterministic.
+
+#define SIMULATOR_MAX_TASKS 16
+
+typedef void (*simulatorFunction_t)(void *parameters);
+
+typedef struct {
+    const char *name;
+    simulatorFunction_t function;
+    void *parameters;
+    // Reduced fraction, the period in ticks
+    unsigned long long periodNumerator;
+    unsigned long long periodDenominator;
+    // Amount of releases that have run, the next one is releases + 1
+    unsigned long long releases;
+    // Records the timing of every release when not NULL, see
+    // monitorSimulatorTask()
+    taskMonitor_t *monitor;
+    uint64_t deadlineNs;
+} simulatorTask_t;
+
+typedef struct {
+    simulatorTask_t tasks[SIMULATOR_MAX_TASKS];
+    // Indices of the tasks, ordered on their next release
+    size_t heap[SIMULATOR_MAX_TASKS];
+    size_t numberOfTasks;
+    // Release time of the last release that has run, (n / d) ticks, and
+    // the moment the simulator started running the releases at that time
+    unsigned long long lastReleaseNumerator;
+    unsigned long long lastReleaseDenominator;
+    uint64_t lastReleaseNs;
+} simulator_t;
+
+void createSimulator(simulator_t *simulator);
+void addSimulatorTask(simulator_t *simulator, const char *name,
+                      simulatorFunction_t function, void *parameters,
+                      unsigned long long periodNumerator,
+                      unsigned long long periodDenominator);
+void monitorSimulatorTask(simulator_t *simulator, size_t index,
+                          taskMonitor_t *monitor, uint64_t deadlineNs);
+unsigned long long runSimulator(simulator_t *simulator,
+                                unsigned long long endTick);
+void printStatisticsSimulator(simulator_t *simulator);
+
+#endif /* SIMULATOR_H */
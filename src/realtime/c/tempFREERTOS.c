@@ -0,0 +1,268 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tempFREERTOS.h"
+#include "monitor.h"
+#include "trace.h"
+
+#ifdef USE_HOST_SCHEDULER
+// Set hostUSE_SCHED_FIFO to 1 to run the tasks with the SCHED_FIFO policy,
+// their FreeRTOS priorities are spread over the SCHED_FIFO priorities.
+// This needs root or CAP_SYS_NICE, otherwise the default policy is used.
+#ifndef hostUSE_SCHED_FIFO
+#define hostUSE_SCHED_FIFO 0
+#endif
+
+struct hostTask {
+    TaskFunction_t code;
+    const char *name;
+    void *parameters;
+    UBaseType_t priority;
+    pthread_t thread;
+    // Release statistics: how late the task woke up after its release
+    // time, and the releases that were already past when the task called
+    // vTaskDelayUntil() (the task ran longer than its period)
+    size_t releases;
+    size_t overruns;
+    unsigned long long totalLatenessNs;
+    unsigned long long maxLatenessNs;
+    // Timing of every job, from the return of vTaskDelayUntil() until it
+    // is called again, see vTaskCollectMonitors()
+    taskMonitor_t monitor;
+    unsigned long long jobStartNs;
+};
+
+static struct hostTask tasks[hostMAX_TASKS];
+static size_t numberOfTasks = 0;
+static struct timespec startTime;
+static unsigned long long startTimeNs;
+static pthread_barrier_t startBarrier;
+static atomic_bool schedulerRunning = false;
+static atomic_bool schedulerEnded = false;
+// Only changed before the threads are created, see vTaskSetTickRate()
+static unsigned long long tickRateHz = hostDEFAULT_TICK_RATE_HZ;
+static __thread struct hostTask *currentTask = NULL;
+
+void *runHostTask(void *argument);
+void setPriority(pthread_attr_t *attributes, UBaseType_t priority);
+unsigned long long nanosecondsSinceStart(void);
+unsigned long long ticksToNanoseconds(TickType_t ticks);
+struct timespec timeOfTick(TickType_t tick);
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+                       uint16_t usStackDepth, void *pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask) {
+    if (numberOfTasks == hostMAX_TASKS || atomic_load(&schedulerRunning)) {
+        return pdFAIL;
+    }
+
+    struct hostTask *task = &tasks[numberOfTasks++];
+    memset(task, 0, sizeof(struct hostTask));
+    task->code = pxTaskCode;
+    task->name = pcName;
+    task->parameters = pvParameters;
+    // usStackDepth is ignored, the pthread gets the default stack size
+    task->priority = uxPriority < configMAX_PRIORITIES ?
+                     uxPriority : configMAX_PRIORITIES - 1;
+    createTaskMonitor(&task->monitor, pcName);
+
+    if (pxCreatedTask != NULL) *pxCreatedTask = task;
+    return pdPASS;
+}
+
+// Sets the amount of ticks per second, the sample rate of the input, so
+// the periods of the tasks are in samples of that rate. Has to be called
+// before vTaskStartScheduler().
+void vTaskSetTickRate(uint32_t ulTickRateHz) {
+    if (ulTickRateHz == 0 || atomic_load(&schedulerRunning)) {
+        printf("Error in 'vTaskSetTickRate': can not set a tick rate of"
+               " %u Hz now.\n", ulTickRateHz);
+        exit(EXIT_FAILURE);
+    }
+    tickRateHz = ulTickRateHz;
+}
+
+// Starts every created task at the same time (tick 0) and returns after
+// vTaskEndScheduler() has been called and every task has stopped.
+void vTaskStartScheduler(void) {
+    pthread_barrier_init(&startBarrier, NULL, (unsigned) numberOfTasks + 1);
+
+    for (size_t i = 0; i < numberOfTasks; i++) {
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        setPriority(&attributes, tasks[i].priority);
+
+        int error = pthread_create(&tasks[i].thread, &attributes, runHostTask,
+                                   &tasks[i]);
+        if (error == EPERM) {
+            // Not allowed to use SCHED_FIFO, use the default policy
+            printf("Warning in 'vTaskStartScheduler': no permission for"
+                   " SCHED_FIFO, %s uses the default policy.\n",
+                   tasks[i].name);
+            pthread_attr_setinheritsched(&attributes, PTHREAD_INHERIT_SCHED);
+            error = pthread_create(&tasks[i].thread, &attributes,
+                                   runHostTask, &tasks[i]);
+        }
+        pthread_attr_destroy(&attributes);
+        if (error != 0) {
+            printf("Error in 'vTaskStartScheduler': could not create the"
+                   " thread of %s (%s).\n", tasks[i].name, strerror(error));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    startTimeNs = (unsigned long long) startTime.tv_sec * 1000000000ULL +
+                  (unsigned long long) startTime.tv_nsec;
+    atomic_store(&schedulerRunning, true);
+    pthread_barrier_wait(&startBarrier);
+
+    for (size_t i = 0; i < numberOfTasks; i++) {
+        pthread_join(tasks[i].thread, NULL);
+    }
+    atomic_store(&schedulerRunning, false);
+    pthread_barrier_destroy(&startBarrier);
+}
+
+// Every task stops the next time it calls vTaskDelayUntil()
+void vTaskEndScheduler(void) {
+    atomic_store(&schedulerEnded, true);
+}
+
+void setPriority(pthread_attr_t *attributes, UBaseType_t priority) {
+#if hostUSE_SCHED_FIFO
+    const int minimum = sched_get_priority_min(SCHED_FIFO);
+    const int maximum = sched_get_priority_max(SCHED_FIFO);
+    struct sched_param parameters = {
+        .sched_priority = minimum + (int) priority * (maximum - minimum) /
+                                    (configMAX_PRIORITIES - 1)
+    };
+    pthread_attr_setinheritsched(attributes, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(attributes, SCHED_FIFO);
+    pthread_attr_setschedparam(attributes, &parameters);
+#else
+    (void) attributes;
+    (void) priority;
+#endif /* hostUSE_SCHED_FIFO */
+}
+
+void *runHostTask(void *argument) {
+    currentTask = (struct hostTask *) argument;
+    pthread_barrier_wait(&startBarrier);
+    currentTask->jobStartNs = nanosecondsSinceStart();
+    currentTask->code(currentTask->parameters);
+    return NULL;
+}
+
+// Ticks since vTaskStartScheduler(), 0 before it
+TickType_t xTaskGetTickCount(void) {
+    if (!atomic_load(&schedulerRunning)) return 0;
+    // Whole seconds and the rest apart, so the products fit in 64 bits
+    const unsigned long long ns = nanosecondsSinceStart();
+    return (TickType_t) (ns / 1000000000ULL * tickRateHz +
+                         ns % 1000000000ULL * tickRateHz / 1000000000ULL);
+}
+
+// Sleeps until tick *pxPreviousWakeTime + xTimeIncrement, which becomes
+// the new *pxPreviousWakeTime. The release is absolute, so the time the
+// task ran doesn't add up over the periods.
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime,
+                     TickType_t xTimeIncrement) {
+    if (atomic_load(&schedulerEnded)) pthread_exit(NULL);
+
+    // The job that ends here was released at the previous wake time, its
+    // deadline is the next one
+    const unsigned long long jobEndNs = nanosecondsSinceStart();
+    if (currentTask != NULL) {
+        pushTaskMonitor(&currentTask->monitor,
+                        ticksToNanoseconds(*pxPreviousWakeTime),
+                        currentTask->jobStartNs, jobEndNs,
+                        ticksToNanoseconds(xTimeIncrement));
+        // The trace uses the times of monitorTimestamp()
+        traceJob(currentTask->name, (uint32_t) (currentTask - tasks),
+                 startTimeNs + currentTask->jobStartNs,
+                 startTimeNs + jobEndNs);
+    }
+
+    *pxPreviousWakeTime += xTimeIncrement;
+    const unsigned long long releaseNs = ticksToNanoseconds(
+                                         *pxPreviousWakeTime);
+    bool overrun = jobEndNs > releaseNs;
+
+    struct timespec release = timeOfTick(*pxPreviousWakeTime);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &release,
+                           NULL) == EINTR);
+
+    if (currentTask != NULL) {
+        unsigned long long now = nanosecondsSinceStart();
+        unsigned long long lateness = now > releaseNs ? now - releaseNs : 0;
+        currentTask->jobStartNs = now;
+        currentTask->releases++;
+        currentTask->overruns += overrun;
+        currentTask->totalLatenessNs += lateness;
+        if (lateness > currentTask->maxLatenessNs) {
+            currentTask->maxLatenessNs = lateness;
+        }
+    }
+    if (atomic_load(&schedulerEnded)) pthread_exit(NULL);
+}
+
+// Moves the timing of the jobs of every task into its histograms. Has to
+// be called at least every MONITOR_RING_SIZE jobs of the fastest task,
+// e.g. by a task with a low priority, otherwise jobs are not counted.
+void vTaskCollectMonitors(void) {
+    for (size_t i = 0; i < numberOfTasks; i++) {
+        collectTaskMonitor(&tasks[i].monitor);
+    }
+}
+
+void vTaskPrintSchedulerStatistics(void) {
+    printf("%-16s %8s %10s %10s %16s %16s\n", "task", "priority",
+           "releases", "overruns", "avg. late (us)", "max. late (us)");
+    for (size_t i = 0; i < numberOfTasks; i++) {
+        struct hostTask *task = &tasks[i];
+        double average = task->releases == 0 ? 0.0 :
+                         (double) task->totalLatenessNs / task->releases;
+        printf("%-16s %8lu %10zu %10zu %16.1f %16.1f\n", task->name,
+               task->priority, task->releases, task->overruns,
+               average / 1e3, task->maxLatenessNs / 1e3);
+    }
+    for (size_t i = 0; i < numberOfTasks; i++) {
+        printStatisticsTaskMonitor(&tasks[i].monitor);
+    }
+}
+
+unsigned long long nanosecondsSinceStart(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) (now.tv_sec - startTime.tv_sec) *
+           1000000000ULL + (unsigned long long) now.tv_nsec -
+           (unsigned long long) startTime.tv_nsec;
+}
+
+// Rounded up, so xTaskGetTickCount() is at least tick at that time. Whole
+// seconds and the rest apart, so the products fit in 64 bits.
+unsigned long long ticksToNanoseconds(TickType_t ticks) {
+    return ticks / tickRateHz * 1000000000ULL +
+           (ticks % tickRateHz * 1000000000ULL + tickRateHz - 1) /
+           tickRateHz;
+}
+
+struct timespec timeOfTick(TickType_t tick) {
+    unsigned long long ns = (unsigned long long) startTime.tv_nsec +
+                            ticksToNanoseconds(tick);
+    struct timespec time = {
+        .tv_sec = startTime.tv_sec + (time_t) (ns / 1000000000ULL),
+        .tv_nsec = (long) (ns % 1000000000ULL)
+    };
+    return time;
+}
+#endif /* USE_HOST_SCHEDULER */
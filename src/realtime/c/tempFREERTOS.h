@@ -4,18 +4,15 @@
 #include <stdint.h>
 
 typedef uint64_t TickType_t;
-static inline TickType_t xTaskGetTickCount(void) { return (TickType_t)0; };
-static inline void vTaskDelayUntil(TickType_t *pxPreviousWakeTime, 
-                                   TickType_t xTimeIncrement) { return; };
 
 /* The defines below are directly copied from the windows port: */
 #define configMAX_PRIORITIES	        ( 7 )
 #define configTIMER_TASK_PRIORITY       ( configMAX_PRIORITIES - 1 )
 
-/* In this non-real time simulated environment the tick frequency has to 
-    be at least a multiple of the Win32 tick frequency, and therefore very 
+/* In this non-real time simulated environment the tick frequency has to
+    be at least a multiple of the Win32 tick frequency, and therefore very
     slow. */
-#define configTICK_RATE_HZ      ( 1000 ) 
+#define configTICK_RATE_HZ      ( 1000 )
 
 #ifndef pdMS_TO_TICKS
 #define pdMS_TO_TICKS( xTimeInMs ) ( ( TickType_t ) ( ( ( TickType_t ) \
@@ -23,4 +20,50 @@ static inline void vTaskDelayUntil(TickType_t *pxPreviousWakeTime,
         ( TickType_t ) 1000 ) )
 #endif
 
+#ifndef USE_HOST_SCHEDULER
+static inline TickType_t xTaskGetTickCount(void) { return (TickType_t)0; };
+static inline void vTaskDelayUntil(TickType_t *pxPreviousWakeTime,
+                                   TickType_t xTimeIncrement) { return; };
+#else
+// Define USE_HOST_SCHEDULER (e.g. with -DUSE_HOST_SCHEDULER) to run the
+// vTask functions for real on Linux, every task on its own pthread, see
+// tempFREERTOS.c. The buffers between the tasks then need USE_SPSC_BUFFER.
+
+#include <stddef.h>
+
+// The periods in the settings are amounts of samples (the Recognize Task
+// runs every 882 ticks), so a tick lasts one sample. The tick rate is the
+// sample rate, 44.1 kHz unless vTaskSetTickRate() sets another one.
+#ifndef hostDEFAULT_TICK_RATE_HZ
+#define hostDEFAULT_TICK_RATE_HZ ( 44100 )
+#endif
+
+// Maximum amount of tasks xTaskCreate() can create
+#define hostMAX_TASKS           ( 16 )
+
+#define pdPASS                  ( 1 )
+#define pdFAIL                  ( 0 )
+#define configMINIMAL_STACK_SIZE ( ( uint16_t ) 1024 )
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct hostTask *TaskHandle_t;
+
+BaseType_t xTaskCreate(TaskFunction_t pxTaskCode, const char *pcName,
+                       uint16_t usStackDepth, void *pvParameters,
+                       UBaseType_t uxPriority, TaskHandle_t *pxCreatedTask);
+void vTaskSetTickRate(uint32_t ulTickRateHz);
+void vTaskStartScheduler(void);
+void vTaskEndScheduler(void);
+TickType_t xTaskGetTickCount(void);
+// Like in FreeRTOS the release is absolute: *pxPreviousWakeTime advances
+// by exactly xTimeIncrement, so a task that reads xTaskGetTickCount() once
+// before its loop isn't delayed by a late release or its own run time.
+void vTaskDelayUntil(TickType_t *pxPreviousWakeTime,
+                     TickType_t xTimeIncrement);
+void vTaskCollectMonitors(void);
+void vTaskPrintSchedulerStatistics(void);
+#endif /* USE_HOST_SCHEDULER */
+
 #endif /* TEMPFREERTOS_H */
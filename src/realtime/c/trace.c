@@ -0,0 +1,179 @@
+#ifdef USE_TRACE
+#include "trace.h"
+#include "monitor.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Tracks of which the name is written to the trace, the jobs of other
+// tracks are shown without a name
+#define TRACE_MAX_TRACKS 64
+
+static traceEvent_t *events = NULL;
+static size_t capacity = 0;
+// Total amount of events ever recorded, event i is at events[i % capacity]
+static _Atomic size_t recorded = 0;
+static char *tracePath = NULL;
+// Argument of the job the thread is running, see traceJobArgument()
+static __thread const char *jobArgumentKey = NULL;
+static __thread uint64_t jobArgumentValue = 0;
+
+traceEvent_t *claimTraceEvent(void);
+void writeTraceEvent(FILE *fp, traceEvent_t *event, uint64_t originNs);
+void writeTrackNames(FILE *fp, size_t first, size_t last);
+
+// Allocates the ring for capacity events (TRACE_DEFAULT_EVENTS for 0) and
+// writes it to path at exit, or when flushTrace() is called before.
+void openTrace(const char *path, size_t newCapacity) {
+    if (events != NULL) {
+        printf("Error in 'openTrace': a trace to %s is already open.\n",
+               tracePath);
+        exit(EXIT_FAILURE);
+    }
+
+    capacity = newCapacity == 0 ? TRACE_DEFAULT_EVENTS : newCapacity;
+    events = malloc(capacity * sizeof(traceEvent_t));
+    tracePath = malloc(strlen(path) + 1);
+    if (events == NULL || tracePath == NULL) {
+        printf("Error in 'openTrace': malloc failed to allocate %zu"
+               " events.\n", capacity);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(tracePath, path);
+    // Touch every page now, so recording an event never page faults
+    memset(events, 0, capacity * sizeof(traceEvent_t));
+    atomic_store(&recorded, 0);
+    atexit(flushTrace);
+}
+
+// Records a job of the task that ran from startNs until endNs (times of
+// monitorTimestamp()), with the argument the job set
+void traceJob(const char *name, uint32_t track, uint64_t startNs,
+              uint64_t endNs) {
+    traceEvent_t *event = claimTraceEvent();
+    if (event == NULL) return;
+
+    event->type = TRACE_JOB;
+    event->name = name;
+    event->track = track;
+    event->startNs = startNs;
+    event->endNs = endNs;
+    event->argumentKey = jobArgumentKey;
+    event->value = jobArgumentValue;
+    jobArgumentKey = NULL;
+}
+
+// Adds an argument to the job the calling thread is running, e.g. the
+// amount of samples it processed. Only the last argument is kept.
+void traceJobArgument(const char *key, uint64_t value) {
+    jobArgumentKey = key;
+    jobArgumentValue = value;
+}
+
+// Records the value of the counter now
+void traceCounter(const char *name, uint64_t value) {
+    traceEvent_t *event = claimTraceEvent();
+    if (event == NULL) return;
+
+    event->type = TRACE_COUNTER;
+    event->name = name;
+    event->track = 0;
+    event->startNs = monitorTimestamp();
+    event->endNs = event->startNs;
+    event->argumentKey = NULL;
+    event->value = value;
+}
+
+// Writes the events in the ring to the path of openTrace() and frees the
+// ring, the events recorded afterwards are ignored. Has to be called when
+// no other thread records events anymore.
+void flushTrace(void) {
+    if (events == NULL) return;
+
+    const size_t last = atomic_load(&recorded);
+    const size_t first = last > capacity ? last - capacity : 0;
+    FILE *fp = fopen(tracePath, "w");
+    if (fp == NULL) {
+        printf("Error in 'flushTrace': could not create %s.\n", tracePath);
+        exit(EXIT_FAILURE);
+    }
+
+    // The jobs are recorded at their end, so the oldest start is not
+    // always the first event
+    uint64_t originNs = UINT64_MAX;
+    for (size_t i = first; i < last; i++) {
+        if (events[i % capacity].startNs < originNs) {
+            originNs = events[i % capacity].startNs;
+        }
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"args\":{\"name\":\"RTES\"}}");
+    writeTrackNames(fp, first, last);
+    for (size_t i = first; i < last; i++) {
+        writeTraceEvent(fp, &events[i % capacity], originNs);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    printf("trace: %zu events written to %s, %zu overwritten\n",
+           last - first, tracePath, first);
+    free(events);
+    free(tracePath);
+    events = NULL;
+    tracePath = NULL;
+}
+
+// Gives the slot of the next event, the oldest event when the ring is full
+traceEvent_t *claimTraceEvent(void) {
+    if (events == NULL) return NULL;
+    size_t index = atomic_fetch_add_explicit(&recorded, 1,
+                                             memory_order_relaxed);
+    return &events[index % capacity];
+}
+
+// A job is a complete event ("X") on the row of its track, a counter is a
+// counter event ("C") which is drawn as a graph of its own
+void writeTraceEvent(FILE *fp, traceEvent_t *event, uint64_t originNs) {
+    const double ts = (event->startNs - originNs) / 1e3;
+    if (event->type == TRACE_COUNTER) {
+        fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,"
+                    "\"pid\":1,\"args\":{\"samples\":%llu}}", event->name,
+                ts, (unsigned long long) event->value);
+        return;
+    }
+
+    const double dur = (event->endNs - event->startNs) / 1e3;
+    fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"task\",\"ph\":\"X\","
+                "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+            event->name, ts, dur, event->track);
+    if (event->argumentKey != NULL) {
+        fprintf(fp, ",\"args\":{\"%s\":%llu}", event->argumentKey,
+                (unsigned long long) event->value);
+    }
+    fprintf(fp, "}");
+}
+
+// Names every track after the first job on it
+void writeTrackNames(FILE *fp, size_t first, size_t last) {
+    bool named[TRACE_MAX_TRACKS] = { false };
+    for (size_t i = first; i < last; i++) {
+        traceEvent_t *event = &events[i % capacity];
+        if (event->type != TRACE_JOB || event->track >= TRACE_MAX_TRACKS ||
+            named[event->track]) {
+            continue;
+        }
+        named[event->track] = true;
+        fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                    "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                event->track, event->name);
+        fprintf(fp, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\","
+                    "\"pid\":1,\"tid\":%u,\"args\":{\"sort_index\":%u}}",
+                event->track, event->track);
+    }
+}
+#endif /* USE_TRACE */
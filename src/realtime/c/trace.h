@@ -0,0 +1,51 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Define USE_TRACE (e.g. with -DUSE_TRACE, see make_trace.sh) to record
+// the jobs of the tasks, the occupancy of the buffers and the size of the
+// Cancel jobs, the Linux version of the Percepio Trace Recorder of the
+// legacy FreeRTOS build. The events are kept in a ring that is allocated
+// by openTrace(), the oldest events are overwritten when it is full. At
+// exit the ring is written as Chrome trace-event JSON, which can be opened
+// in chrome://tracing or https://ui.perfetto.dev.
+// Without USE_TRACE the functions below do nothing.
+
+// Amount of events the ring holds when openTrace() gets 0, 32 MB
+#define TRACE_DEFAULT_EVENTS (1024 * 1024)
+
+#ifdef USE_TRACE
+typedef enum {
+    TRACE_JOB, // A job of a task, a slice from startNs to endNs
+    TRACE_COUNTER // A value at startNs, e.g. the samples in a buffer
+} traceType_t;
+
+typedef struct {
+    traceType_t type;
+    const char *name; // Task or counter name, not copied
+    uint32_t track; // Row of the job in the viewer
+    uint64_t startNs;
+    uint64_t endNs;
+    // Argument of a job (NULL if none), see traceJobArgument(), or the
+    // value of a counter
+    const char *argumentKey;
+    uint64_t value;
+} traceEvent_t;
+
+void openTrace(const char *path, size_t capacity);
+void traceJob(const char *name, uint32_t track, uint64_t startNs,
+              uint64_t endNs);
+void traceJobArgument(const char *key, uint64_t value);
+void traceCounter(const char *name, uint64_t value);
+void flushTrace(void);
+#else
+#define openTrace(path, capacity) ((void) 0)
+#define traceJob(name, track, startNs, endNs) ((void) 0)
+#define traceJobArgument(key, value) ((void) 0)
+#define traceCounter(name, value) ((void) 0)
+#define flushTrace() ((void) 0)
+#endif /* USE_TRACE */
+
+#endif /* TRACE_H */
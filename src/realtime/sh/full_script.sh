@@ -1,22 +1,22 @@
 #!/bin/bash
 
-# Convert the wav file to the dataheader for the program to use
-python3 ../python/wav_to_header_and_csv.py \
-        -wavfile ../wav/train_short.wav -csvfile '../csv/train_short.csv' \
-        -dataheader ../c/data.h
-
 # Shell has to be in the c folder in order to compile
 cd ../c
 
-# Compile the program
+# Compile the program and the convert tool
 ./make.sh
 
-# Run the program
-./a.out
+# Convert the wav file to csv, to compare the output with. To run the
+# program without a wav file data.h can be made from the wav file as well:
+# ./convert ../wav/train_short.wav data.h
+./convert ../wav/train_short.wav ../csv/train_short.csv
+
+# Run the program, it reads the wav file and writes the output wav file
+# directly
+./a.out ../wav/train_short.wav ../wav/output.wav
+
+# Create the csv file used by output_to_graph.sh from the output wav file
+./convert ../wav/output.wav ../csv/output.csv
 
 # Return to the scripts folder
 cd ../sh
-
-# Create a wav file from the csv file outputted by the program
-python3 ../python/csv_to_wav.py -csvfile ../csv/output.csv \
-        -wavfile ../wav/output.wav -samplerate 44100